@@ -3,7 +3,7 @@
 
   Purpose: For each turn, print the move selected, estimated wins, estimated probability this is the best move, and print the board position
 
-  Version: 2.4.1
+  Version: 4.9
 
   Version History (And Goals):
   0.1)   Created c4Board class
@@ -30,6 +30,35 @@
   2.3)   Gave MCTS full control of board. TODO: Tweak selection criteria, still choosing columns that are full
   2.4)   Tweaked selection criteria.
   2.4.1) Fixed an issue where column 0 was never chosen. Literally didn't do anything, but the problem is gone now...
+  2.5)   Transposition-aware search: positions are hashed (Zobrist) and share statistics through a TranspositionTable (UCT on a DAG)
+  2.6)   MCTS-Solver: terminal positions are propagated as proven wins/losses/draws, proven subtrees are skipped
+  2.7)   Optional RAVE: all-moves-as-first statistics per position, blended into UCT selection
+  2.8)   Anytime search: makeMove() overloads that stop at a deadline, a node budget or a playout budget
+  2.9)   Sequential halving root allocation: the worse half of the moves is dropped after each round of playouts
+  -----------------------------
+  3.0)   Root parallel search: independent searches on several threads, root move statistics are summed
+  3.1)   Shared tree parallel search: one tree with atomic statistics, virtual loss and lock-free expansion
+  3.2)   Work-stealing thread pool for search tasks (flat sampling is split into small playout tasks)
+  3.3)   Lock-free shared transposition table (XOR-verified entries) so parallel searches share position statistics
+  3.4)   Pondering: the engine keeps searching on a background thread while the opponent thinks (--human --ponder)
+  3.5)   Headless self-play: engine vs engine games in parallel, results and move lists written to a file (--selfplay)
+  3.6)   Batch analysis of positions read from a file or stdin, searched in parallel through a bounded queue (--analyse)
+  3.7)   Root parallel search in forked worker processes over Unix domain sockets (--processes)
+  3.8)   Deterministic parallel mode: the same seed and thread count give the same moves and statistics (--deterministic)
+  3.9)   Per thread, cache line padded counters for the upper levels of the shared tree and a scaling benchmark (--scaling)
+  -----
+  4.0)   Exact negamax solver on bitboards (--solve), used by makeMove() once few empty cells are left
+  4.1)   Transposition table for the solver with 8 byte entries (keys truncated to 32 bits, Chinese remainder theorem)
+  4.2)   Solver narrows the score with null window searches, weak (win/draw/loss only) solving for makeMove() and --weak
+  4.3)   Opening book of solved positions (mirror canonical, sorted binary file, memory mapped) built with --makebook, used with --book
+  4.4)   Opening book built on a thread pool with a shared solver table, checkpointed so an interrupted build can resume
+  4.5)   Lazy SMP solver: threads with different move orders share the solver table, the first to finish stops the others (--solvescaling)
+  4.6)   Hybrid MCTS: new leaves with few empty cells are solved exactly instead of played out (threshold adapts to the budget)
+  4.7)   Perft: counts move sequences and unique positions to a depth on both board kernels, on a thread pool (--perft)
+  4.8)   Endgame tablebase: positions with few empty cells below a root, enumerated layer by layer and labelled win/draw/loss
+         from the last layer back, 2 bits per position in a memory mapped file used by makeMove() and playouts (--maketablebase)
+  4.9)   Perfect position ranking (column heights, then colours) relative to a base position: the tablebase is plain 2 bit
+         arrays indexed by rank, without keys, marked from sorted runs of child ranks (--tablebasememory)
 
   Program Algorithm:
   1. Initialize an instance of c4Board for a new game
@@ -59,6 +88,28 @@
 #include <vector>     // Allows use of vectors (and push_back)
 #include <random>     // Allows use of subtract_with_carry_engine (fastest PRNG in C++11)
 #include <chrono>     // Allows access to system clock
+#include <iomanip>    // Allows use of setw()
+#include <cmath>      // Allows use of sqrt() and log() (UCT selection)
+#include <memory>     // Allows use of unique_ptr
+#include <algorithm>  // Allows use of max() and stable_sort()
+#include <functional> // Allows passing lambdas to sequentialHalving()
+#include <thread>     // Allows searching on several threads
+#include <atomic>     // Allows statistics shared between threads
+#include <mutex>      // Allows locking (WorkStealingPool deques)
+#include <condition_variable>   // Allows idle pool workers to sleep
+#include <deque>      // Allows double ended queues (WorkStealingPool)
+#include <sstream>    // Allows parsing engine settings from strings
+#include <sys/socket.h>   // Allows socketpair() (ProcessWorkers)
+#include <sys/wait.h>     // Allows waitpid()
+#include <poll.h>         // Allows waiting for several workers' replies at once
+#include <signal.h>       // Allows kill()
+#include <unistd.h>       // Allows fork(), read(), write() and close()
+#include <cstdint>        // Allows fixed width integers (bitboards)
+#include <sys/mman.h>       // Allows mmap() (OpeningBook, Tablebase)
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unordered_set>    // Allows removing duplicate positions
+#include <cstring>          // Allows memcpy() and memcmp()
 
 // Allows test cases
 #define DOCTEST_CONFIG_IMPLEMENT
@@ -66,610 +117,4702 @@
 
 using namespace std;
 
-// Define some class data structures
-class c4Board {
-    /*
-    0 |  -1  -1  -1  -1  -1  -1  -1
-    1 |  -1  -1  -1  -1  -1  -1  -1
-    2 |  -1  -1  -1  -1  -1  -1  -1
-    3 |  -1  -1  -1  -1  -1  -1  -1
-    4 |  -1  -1  -1  -1  -1  -1  -1
-    5 |  -1  -1  -1  -1  -1  -1  -1
-    --|----------------------------
-      |   0   1   2   3   4   5   6
-    */
-  public:
-    array<array<int, 7>, 6> tileSpaces;   // [rows][columns] -> [0-5][0-6]
+typedef subtract_with_carry_engine<unsigned,24,10,24> c4Generator;   // PRNG used for playouts
 
-    c4Board *previousMove;    // Dereference pointer to previous node
-    c4Board *nextMove;        // Dereference pointer to next node
+// Returns the Zobrist key for a token of the given player (1 or 2) at [row][column]
+unsigned long long zobristKey(int row, int col, int player){
+  static array<unsigned long long, 6 * 7 * 2> keys = [](){
+    array<unsigned long long, 6 * 7 * 2> generated;
+    mt19937_64 keyGenerator(0xC4C4C4C4ULL);    // Fixed seed so hashes are the same every run
+    for (size_t i = 0; i < generated.size(); i++){
+      generated[i] = keyGenerator();
+    }
+    return generated;
+  }();
+  return keys[(row * 7 + col) * 2 + (player - 1)];
+}
 
-    int playerJustMoved;    // The player who just played (1 is Red Player & 2 is Yellow) TODO: change this to currentPlayer
-    bool endOfGame;         // Is true if no more moves are possible or necessary
-    int winningPlayer;      // The player number of the player that won
+// Hash of the empty board. Non-zero so that a key of 0 can mark an empty TranspositionTable slot
+const unsigned long long emptyBoardHash = 0x9E3779B97F4A7C15ULL;
 
-    // Default Class Constructor (Only called initially)
-    c4Board(){
-      for (int i = 0; i <= 7; i++) {     // For each row
-        for (int j = 0; j <= 6; j++) {    // For each column
-          this->tileSpaces[i][j] = -1;      // write as default value
-        }
+// Computes the hash of a position from scratch (Node keeps its hash updated incrementally)
+unsigned long long positionHash(const array<array<int, 7>, 6>& tileSpaces){
+  unsigned long long hash = emptyBoardHash;
+  for (int i = 0; i < 6; i++) {        // For each row
+    for (int j = 0; j < 7; j++) {      // For each column
+      if (tileSpaces[i][j] != -1){
+        hash ^= zobristKey(i, j, tileSpaces[i][j]);
       }
-
-      // Initialize to default values
-      this->previousMove = nullptr;
-      this->nextMove = nullptr;
-      this->playerJustMoved = -1;
-      this->endOfGame = false;        // Default to false, only changed by gameOver()
     }
+  }
+  return hash;
+}
 
-    // Class Constructor for creating a next Node (with link to previous)
-    c4Board(c4Board* previousBoard, int playerNum){    // pointer to previous board, number of current player
-      this->tileSpaces = previousBoard->tileSpaces;  // Copy
+// Statistics for one position, shared by every path that reaches it
+class TTEntry {
+  public:
+    unsigned long long key;   // Position hash (0 means the slot is empty)
+    int ni;   // Number of playouts that passed through this position
+    int wi;   // Number of those playouts won by the player who just moved into this position
+    int di;   // Number of those playouts that were draws
+    unsigned int generation;    // Search that last touched this entry (used by the replacement policy)
 
-      this->previousMove = previousBoard;   // link previousMove to the given pointer
-      this->nextMove = nullptr;             // Dereference the class pointer for next node
-      previousBoard->nextMove = this;      // link nextMove of previousBoard to this
+    // MCTS-Solver values (only set when SearchSettings::useSolver is true)
+    bool isProven;      // True once the game theoretic value of this position is known
+    int provenValue;    // 1 = win, 0 = draw, -1 = loss (for the player who just moved into this position)
+    int provenDepth;    // Number of plies until the game ends with best play
 
-      this->playerJustMoved = playerNum;    // playerNum is the current player (of previous board), stored to playerJustMoved
-      this->endOfGame = false;              // Default to false, only changed by gameOver()
-      this->winningPlayer = -1;             // Will remain negative one until either Red or Yellow wins (does not change for Draw)
+    // All-moves-as-first statistics for each column played by the player to move (only updated when SearchSettings::useRave is true)
+    array<int, 7> amafN;    // Playouts from this position in which the player to move played the column
+    array<int, 7> amafW;    // How many of them that player won
+    array<int, 7> amafD;    // How many of them were draws
+
+    TTEntry(){
+      this->key = 0;
+      this->ni = 0;
+      this->wi = 0;
+      this->di = 0;
+      this->generation = 0;
+      this->isProven = false;
+      this->provenValue = 0;
+      this->provenDepth = 0;
+      this->amafN.fill(0);
+      this->amafW.fill(0);
+      this->amafD.fill(0);
     }
+};
 
-    // Class Copy Constrcutor for creating a new instance from a given instance
-    c4Board (const c4Board &givenBoard) {
-      this->tileSpaces = givenBoard.tileSpaces;
+class TranspositionTable {
+  /*
+  Maps position hashes to TTEntry statistics so that transpositions (the same position reached by different move orders) are only searched once.
+  The table has a fixed size: entries are grouped in buckets of 4 and when a bucket is full the entry from the oldest search with the fewest playouts is replaced.
+  */
+  public:
+    static const int bucketSize = 4;
 
-      this->previousMove = givenBoard.previousMove;
-      this->nextMove = givenBoard.nextMove;
+    vector<TTEntry> entries;
+    unsigned long long bucketMask;    // Number of buckets - 1 (number of buckets is a power of two)
+    unsigned int generation;          // Incremented by newSearch()
 
-      this->playerJustMoved = givenBoard.playerJustMoved;
-      this->endOfGame = givenBoard.endOfGame;
-    }
+    // Counters (for tuning the table size)
+    long long hits;
+    long long misses;
+    long long replacements;
 
-    friend ostream &operator<<(ostream &output, const c4Board& obj) {
-      string rows = "012345";
-      string columns = "0123456";
-      for (int i = 0; i < obj.tileSpaces.size(); i++) {        // For each row
-        output << rows[i] << " |";
-        for (int j = 0; j < obj.tileSpaces[i].size(); j++) {   // For each column
-          if (obj.tileSpaces[i][j] == -1) {
-            output << setw(4) << ".";
-          }
-          else if (obj.tileSpaces[i][j] == 1) {
-            output << setw(4) << "R";
-          }
-          else if (obj.tileSpaces[i][j] == 2) {
-            output << setw(4) << "Y";
-          }
-        }
-        output << endl;
-      }
-      output << "--|----------------------------" << endl << "  |";
-      for (int i = 0; i < columns.length(); i++){
-        output << setw(4) << columns[i];
+    TranspositionTable(int sizeMB){
+      unsigned long long numBuckets = 1;
+      while ((numBuckets * 2) * bucketSize * sizeof(TTEntry) <= (unsigned long long)sizeMB * 1024 * 1024){
+        numBuckets *= 2;
       }
-      output << endl;
-      return output;
+      this->entries.resize(numBuckets * bucketSize);
+      this->bucketMask = numBuckets - 1;
+      this->generation = 0;
+      this->hits = 0;
+      this->misses = 0;
+      this->replacements = 0;
     }
 
-    // TODO: does c4Board need this or just Node?
-    friend bool operator==(const c4Board& lhs, const c4Board& rhs) {       // p1.operator==(p2)
-      return lhs.tileSpaces == rhs.tileSpaces;
+    // Returns the entry for key, or nullptr if the position is not stored
+    TTEntry* lookup(unsigned long long key){
+      TTEntry* bucket = &this->entries[(key & this->bucketMask) * bucketSize];
+      for (int i = 0; i < bucketSize; i++){
+        if (bucket[i].key == key){
+          this->hits ++;
+          return &bucket[i];
+        }
+      }
+      this->misses ++;
+      return nullptr;
     }
 
-    c4Board dropToken(int colNum) {
-      /*
-      Returns a new instance of c4Board with the latest player's move and a pointer make to the previous state
-      Only allows legal moves (column selection and tokens in a column)
-      */
-      bool validMove = false;     // Changes if a valid move is found
-      int currentPlayer;
-      if (playerJustMoved == -1){
-        currentPlayer = 1;
+    // Returns the entry for key, creating it (and replacing another entry if the bucket is full) if needed
+    TTEntry* insert(unsigned long long key){
+      TTEntry* bucket = &this->entries[(key & this->bucketMask) * bucketSize];
+      TTEntry* victim = &bucket[0];
+      for (int i = 0; i < bucketSize; i++){
+        if (bucket[i].key == key){
+          bucket[i].generation = this->generation;
+          return &bucket[i];
+        }
+        if (bucket[i].key == 0){    // Empty slots are always used first
+          victim = &bucket[i];
+          break;
+        }
+        // Prefer entries from older searches, then entries with fewer playouts
+        if (bucket[i].generation < victim->generation || (bucket[i].generation == victim->generation && bucket[i].ni < victim->ni)){
+          victim = &bucket[i];
+        }
       }
-      else {
-          currentPlayer = 3 - this->playerJustMoved;   // Get the number of the player currently playing
+
+      if (victim->key != 0){
+        this->replacements ++;
       }
+      *victim = TTEntry();
+      victim->key = key;
+      victim->generation = this->generation;
+      return victim;
+    }
 
-      c4Board tmp(this, currentPlayer);   // Create a new board with a pointer back to the current state and the currentPlayer
+    // Called at the start of every move so entries from previous moves are replaced first
+    void newSearch(){
+      this->generation ++;
+    }
 
-      // Iterate through tileSpaces[i][colNum] backwards until tileSpaces[i][i] == -1, then tileSpaces[rowNum][colNum] = currentPlayer
-      for (int i = 5; i >= 0; i--) {   // Starting at the bottom of the row and working to the top
-        //cout << i << ", " << colNum << ": " << tmp.tileSpaces[i][colNum] << endl;   // For test purposes
-        if (tmp.tileSpaces[i][colNum] == -1) {   // If the current tile has no token yet
-          tmp.tileSpaces[i][colNum] = currentPlayer;
-          validMove = true;
-          break;
-        }
-      }
-      if (!validMove) {
-        cout << "This column is already full. Choose a different move" << endl;
-        return *this;   // Return the same instance the function was called from
+    // Forgets every position (the counters are kept)
+    void clear(){
+      fill(this->entries.begin(), this->entries.end(), TTEntry());
+      this->generation = 0;
+    }
+
+    // Value based access, the same interface as LocklessTranspositionTable (used by the search templates)
+    bool probe(unsigned long long key, TTEntry& entry){
+      TTEntry* found = this->lookup(key);
+      if (found == nullptr){
+        return false;
       }
+      entry = *found;
+      return true;
+    }
 
-      return tmp;
+    void store(const TTEntry& entry){
+      TTEntry* slot = this->insert(entry.key);
+      *slot = entry;
+      slot->generation = this->generation;
     }
 
-    bool continuePlaying() {
-      /* Returns "false" to terminate game if winning move is detected, otherwise returns "true" if available moves are left */
+    // Makes sure the position has an entry
+    void touch(unsigned long long key){
+      this->insert(key);
+    }
+};
 
-      // If there are four vertical matching tokens
-      for (int i = 0; i + 3 < this->tileSpaces.size(); i++) {     // For each row
-        for (int j = 0; j < this->tileSpaces[i].size(); j++) {      // For each column
-          // cout << "i: " << i << ", j: " << j << endl;  // For test purposes
-          // cout << this->tileSpaces[i][j] << " " << this->tileSpaces[i + 1][j] << " " << this->tileSpaces[i + 2][j] << " " << this->tileSpaces[i + 3][j] << endl;
-          if (this->tileSpaces[i][j] != -1 && this->tileSpaces[i][j] == this->tileSpaces[i + 1][j] && this->tileSpaces[i][j] == this->tileSpaces[i + 2][j] && this->tileSpaces[i][j] == this->tileSpaces[i + 3][j]){
-            this->winningPlayer = this->tileSpaces[i][j];
-            return false;
-          }
+class LocklessTranspositionTable {
+  /*
+  Fixed-size (power of two) table of position statistics shared by every search thread without locks.
+  An entry is three 64-bit words: two data words and a check word (the key XORed with both data words). A reader only
+  accepts an entry whose check word matches the key it is looking for, so an entry read while another thread was writing it
+  looks like a miss instead of returning mixed up statistics. Two threads updating the same entry at once can lose one
+  of the updates, which only costs a playout.
+  Entries are grouped in buckets of 4 and replaced by age (searches since they were written), then by number of playouts.
+  Only ni/wi/di and proven values are stored (no AMAF statistics).
+  */
+  public:
+    static const int bucketSize = 4;
+
+    class Entry {
+      public:
+        atomic<unsigned long long> check;   // key ^ data1 ^ data2 (all zero = empty)
+        atomic<unsigned long long> data1;   // ni (high 32 bits), wi (low 32 bits)
+        atomic<unsigned long long> data2;   // di (high 32 bits), generation (16 bits), proven flags (16 bits)
+
+        Entry(){
+          this->check = 0;
+          this->data1 = 0;
+          this->data2 = 0;
         }
+    };
+
+    unique_ptr<Entry[]> entries;
+    unsigned long long numEntries;
+    unsigned long long bucketMask;    // Number of buckets - 1
+    atomic<unsigned> generation;
+
+    // Counters
+    atomic<long long> hits;
+    atomic<long long> misses;
+    atomic<long long> stores;
+    atomic<long long> collisions;     // Stores that replaced a different position
+
+    LocklessTranspositionTable(int sizeMB){
+      unsigned long long numBuckets = 1;
+      while ((numBuckets * 2) * bucketSize * sizeof(Entry) <= (unsigned long long)sizeMB * 1024 * 1024){
+        numBuckets *= 2;
       }
+      this->numEntries = numBuckets * bucketSize;
+      this->entries.reset(new Entry[this->numEntries]);
+      this->bucketMask = numBuckets - 1;
+      this->generation = 0;
+      this->hits = 0;
+      this->misses = 0;
+      this->stores = 0;
+      this->collisions = 0;
+    }
 
-      // If there are four horizontal matching tokens
-      for (int i = 0; i < this->tileSpaces.size(); i++) {     // For each row
-        for (int j = 0; j + 3 < this->tileSpaces[i].size(); j++) {      // For each column
-          // cout << "i: " << i << ", j: " << j << endl;  // For test purposes
-          // cout << this->tileSpaces[i][j] << " " << this->tileSpaces[i][j + 1] << " " << this->tileSpaces[i][j + 2] << " " << this->tileSpaces[i][j + 3] << endl;
-          if (this->tileSpaces[i][j] != -1 && this->tileSpaces[i][j] == this->tileSpaces[i][j + 1] && this->tileSpaces[i][j] == this->tileSpaces[i][j + 2] && this->tileSpaces[i][j] == this->tileSpaces[i][j + 3]){
-            this->winningPlayer = this->tileSpaces[i][j];
-            return false;
-          }
+    bool probe(unsigned long long key, TTEntry& entry){
+      Entry* bucket = &this->entries[(key & this->bucketMask) * bucketSize];
+      for (int i = 0; i < bucketSize; i++){
+        unsigned long long data1 = bucket[i].data1.load(memory_order_relaxed);
+        unsigned long long data2 = bucket[i].data2.load(memory_order_relaxed);
+        if ((bucket[i].check.load(memory_order_relaxed) ^ data1 ^ data2) == key){
+          unpack(key, data1, data2, entry);
+          this->hits.fetch_add(1, memory_order_relaxed);
+          return true;
         }
       }
+      this->misses.fetch_add(1, memory_order_relaxed);
+      return false;
+    }
 
-      // If there are four diagonal matching tokens L->R descending
-      for (int i = 0; i + 3 < this->tileSpaces.size(); i++) {     // For each row
-        for (int j = 0; j + 3 < this->tileSpaces[i].size(); j++) {      // For each column
-          // cout << "i: " << i << ", j: " << j << endl;  // For test purposes
-          if (this->tileSpaces[i][j] != -1 && this->tileSpaces[i][j] == this->tileSpaces[i + 1][j + 1] && this->tileSpaces[i][j] == this->tileSpaces[i + 2][j + 2] && this->tileSpaces[i][j] == this->tileSpaces[i + 3][j + 3]){
-            this->winningPlayer = this->tileSpaces[i][j];
-            return false;
-          }
+    void store(const TTEntry& entry){
+      Entry* bucket = &this->entries[(entry.key & this->bucketMask) * bucketSize];
+      Entry* slot = nullptr;
+      int slotAge = -1;
+      unsigned long long slotVisits = 0;
+      bool replacing = false;
+
+      for (int i = 0; i < bucketSize; i++){
+        unsigned long long check = bucket[i].check.load(memory_order_relaxed);
+        unsigned long long data1 = bucket[i].data1.load(memory_order_relaxed);
+        unsigned long long data2 = bucket[i].data2.load(memory_order_relaxed);
+        if ((check ^ data1 ^ data2) == entry.key || (check == 0 && data1 == 0 && data2 == 0)){   // Same position or empty
+          slot = &bucket[i];
+          replacing = false;
+          break;
+        }
+        // Otherwise replace the oldest entry, then the one with the fewest playouts
+        int age = (this->generation - static_cast<unsigned>((data2 >> 16) & 0xFFFF)) & 0xFFFF;
+        unsigned long long visits = data1 >> 32;
+        if (age > slotAge || (age == slotAge && visits < slotVisits)){
+          slot = &bucket[i];
+          slotAge = age;
+          slotVisits = visits;
+          replacing = true;
         }
       }
 
-      // If there are four diagonal matching tokens R->L descending
-      for (int i = 0; i + 3 < this->tileSpaces.size(); i++) {     // For each row
-        for (int j = tileSpaces[i].size(); j >= 3; j--) {      // For each column
-          // cout << "i: " << i << ", j: " << j << endl;  // For test purposes
-          // cout << this->tileSpaces[i][j] << " " << this->tileSpaces[i + 1][j - 1] << " " << this->tileSpaces[i + 2][j - 2] << " " << this->tileSpaces[i + 3][j - 3] << endl;
-          if (this->tileSpaces[i][j] != -1 && this->tileSpaces[i][j] == this->tileSpaces[i + 1][j - 1] && this->tileSpaces[i][j] == this->tileSpaces[i + 2][j - 2] && this->tileSpaces[i][j] == this->tileSpaces[i + 3][j - 3]){
-            this->winningPlayer = this->tileSpaces[i][j];
-            return false;
-          }
-        }
+      unsigned long long data1 = (static_cast<unsigned long long>(static_cast<unsigned>(entry.ni)) << 32) | static_cast<unsigned>(entry.wi);
+      unsigned long long flags = (entry.isProven ? 1 : 0) | ((entry.provenValue + 1) << 1) | (min(entry.provenDepth, 63) << 3);
+      unsigned long long data2 = (static_cast<unsigned long long>(static_cast<unsigned>(entry.di)) << 32) | ((this->generation & 0xFFFFULL) << 16) | flags;
+      slot->data1.store(data1, memory_order_relaxed);
+      slot->data2.store(data2, memory_order_relaxed);
+      slot->check.store(entry.key ^ data1 ^ data2, memory_order_relaxed);
+
+      this->stores.fetch_add(1, memory_order_relaxed);
+      if (replacing){
+        this->collisions.fetch_add(1, memory_order_relaxed);
       }
+    }
 
-      // If any empty spaces remain in the board
-      for (int i = 0; i < this->tileSpaces.size(); i++) {        // For each row
-        for (int j = 0; j < this->tileSpaces[i].size(); j++) {   // For each column
-          if (this->tileSpaces[i][j] == -1){  // This will only execute if there are valid moves left to make
-            return true;
-          }
+    // Makes sure the position has an entry
+    void touch(unsigned long long key){
+      TTEntry entry;
+      if (!this->probe(key, entry)){
+        entry.key = key;
+        this->store(entry);
+      }
+    }
+
+    // Called once at the start of every move (not by every thread) so entries from previous moves are replaced first
+    void newSearch(){
+      this->generation ++;
+    }
+
+    double hitRate(){
+      return static_cast<double>(this->hits) / max(this->hits + this->misses, 1LL);
+    }
+
+    double collisionRate(){
+      return static_cast<double>(this->collisions) / max(this->stores.load(), 1LL);
+    }
+
+    // Fraction of the table in use (estimated from 4096 entries spread over the table)
+    double fill(){
+      unsigned long long step = max(this->numEntries / 4096, 1ULL);
+      unsigned long long sampled = 0;
+      unsigned long long used = 0;
+      for (unsigned long long i = 0; i < this->numEntries; i += step){
+        sampled ++;
+        if (this->entries[i].check != 0 || this->entries[i].data1 != 0 || this->entries[i].data2 != 0){
+          used ++;
         }
       }
+      return static_cast<double>(used) / sampled;
+    }
 
-      // If none of the above returns are triggered
-      return false;
+  private:
+    static void unpack(unsigned long long key, unsigned long long data1, unsigned long long data2, TTEntry& entry){
+      entry = TTEntry();
+      entry.key = key;
+      entry.ni = static_cast<int>(data1 >> 32);
+      entry.wi = static_cast<int>(data1 & 0xFFFFFFFFULL);
+      entry.di = static_cast<int>(data2 >> 32);
+      entry.generation = (data2 >> 16) & 0xFFFF;
+      entry.isProven = (data2 & 1) != 0;
+      entry.provenValue = static_cast<int>((data2 >> 1) & 3) - 1;
+      entry.provenDepth = static_cast<int>((data2 >> 3) & 63);
     }
-  };
+};
 
-class Node {
+// Tasks that were submitted together, so their submitter can wait for just those tasks
+class TaskGroup {
+  public:
+    atomic<long long> pending;    // Submitted but not finished
+
+    TaskGroup(){
+      this->pending = 0;
+    }
+};
+
+class WorkStealingPool {
   /*
-  Some member functions:
-  makeMove()- chooses the best move to make by creating a test node (keeps track of the results for each possible move)
-  X isPossible()- returns true if a token can be dropped in a given column
-  X getChildren()- creates a new node based on a token dropped in the given column
-  X getGameState()- returns -1 for a game in progress, 1 is player 1 has won, 2 if player 2 has won, and 3 if the game is a draw
-  sampleNodePath()- randomly makes moves, checking each new node for final state by calling getGameState()
-  movesLeft()- Returns the number of empty spaces still available on the board (used to calculate how many child nodes there should be)
+  Thread pool for search, batch analysis and self-play tasks.
+  Each worker has its own deque of tasks: it runs its own tasks from the bottom (newest first) and, once its deque is empty,
+  steals the oldest task from the top of another worker's deque. Tasks submitted from a worker go to that worker's deque,
+  tasks submitted from outside the pool are spread round robin.
   */
   public:
-    int ni;   // Accumulator for number of nodes sampled (only count final gameStates)
-    int wi;   // Accumulator for number of nodes that are wins (wi/ni is likelihood of winning)
-    int di;   // Accumulator for number of nodes that are draws
+    atomic<long long> tasksRun;
+    atomic<long long> steals;               // Tasks taken from another worker's deque
+    atomic<long long> idleMicroseconds;     // Total time workers spent waiting for tasks
 
-    // Store a copy of the current game state
-    array<array<int, 7>, 6> tileSpaces;   // [rows][columns]
-    int playerJustMoved;      // The player who just played (1 is Red Player & 2 is Yellow)
-    int winningPlayer;        // The player number of the player that won
+    WorkStealingPool(int numWorkers){
+      this->tasksRun = 0;
+      this->steals = 0;
+      this->idleMicroseconds = 0;
+      this->stopping = false;
+      this->nextQueue = 0;
+      numWorkers = max(numWorkers, 1);
+      for (int i = 0; i < numWorkers; i++){
+        this->queues.push_back(unique_ptr<WorkerQueue>(new WorkerQueue()));
+      }
+      for (int i = 0; i < numWorkers; i++){
+        this->workers.push_back(thread(&WorkStealingPool::workerLoop, this, i));
+      }
+    }
 
-    // Pointers for previous state and each possble next state
-    Node *previousBoard;     // Should be nullptr when initially constructed (root is always the move under consideration)
-    Node *nextMove1;
-    Node *nextMove2;
-    Node *nextMove3;
+    // Tasks still queued are run before the workers stop
+    ~WorkStealingPool(){
+      this->stopping = true;
+      this->wakeUp.notify_all();
+      for (size_t i = 0; i < this->workers.size(); i++){
+        this->workers[i].join();
+      }
+    }
 
-    // Default constructor
-    Node() {
-      // Fill board with placeholder values
-      for (int i = 0; i < this->tileSpaces.size(); i++){
-        for (int j = 0; j < this->tileSpaces[i].size(); j++){
-          this->tileSpaces[i][j] = -1;
+    int size(){
+      return this->workers.size();
+    }
+
+    void submit(TaskGroup& group, function<void()> task){
+      group.pending ++;
+      int queue = (currentPool == this) ? currentWorker : this->nextQueue++ % this->queues.size();
+      {
+        lock_guard<mutex> guard(this->queues[queue]->lock);
+        this->queues[queue]->tasks.push_back([&group, task](){
+          task();
+          group.pending --;
+        });
+      }
+      this->wakeUp.notify_one();
+    }
+
+    // Blocks until every task in group has finished, running queued tasks in the meantime (so workers can wait too)
+    void wait(TaskGroup& group){
+      function<void()> task;
+      while (group.pending > 0){
+        int worker = (currentPool == this) ? currentWorker : -1;
+        if (this->takeTask(worker, task)){
+          task();
+          this->tasksRun ++;
+        }
+        else{
+          this_thread::yield();
         }
       }
+    }
 
-      // Initialize accumulators tp initial value (0)
-      this->ni = 0;
-      this->wi = 0;
-      this->di = 0;
+  private:
+    class WorkerQueue {
+      public:
+        mutex lock;
+        deque<function<void()>> tasks;
+    };
 
-      // Set to placeholder values
-      this->playerJustMoved = -1;
-      this->winningPlayer = -1;
+    vector<unique_ptr<WorkerQueue>> queues;   // One per worker
+    vector<thread> workers;
+    atomic<bool> stopping;
+    atomic<unsigned> nextQueue;     // Queue for the next task submitted from outside the pool
+    mutex sleepLock;
+    condition_variable wakeUp;      // Notified when a task is submitted
 
-      // Set pointers to null value
-      this->previousBoard = nullptr;
-      this->nextMove1 = nullptr;
-      this->nextMove2 = nullptr;
-      this->nextMove3 = nullptr;
-    }
+    static thread_local WorkStealingPool* currentPool;    // Pool the current thread works for (nullptr outside of pools)
+    static thread_local int currentWorker;
 
-    // Constructor called when an instance of Node is created from an instance of c4Board
-    Node(c4Board currentBoard) {
-      // Initialize accumulators to initial value (0)
-      this->ni = 0;
-      this->wi = 0;
-      this->di = 0;
+    // Takes the newest task of worker's own deque, or steals the oldest task of another deque (worker = -1 only steals)
+    bool takeTask(int worker, function<void()>& task){
+      if (worker >= 0){
+        WorkerQueue& own = *this->queues[worker];
+        lock_guard<mutex> guard(own.lock);
+        if (!own.tasks.empty()){
+          task = move(own.tasks.back());
+          own.tasks.pop_back();
+          return true;
+        }
+      }
+      for (size_t i = 1; i <= this->queues.size(); i++){
+        int victim = static_cast<int>((max(worker, 0) + i) % this->queues.size());
+        if (victim == worker){
+          continue;
+        }
+        WorkerQueue& other = *this->queues[victim];
+        lock_guard<mutex> guard(other.lock);
+        if (!other.tasks.empty()){
+          task = move(other.tasks.front());
+          other.tasks.pop_front();
+          this->steals ++;
+          return true;
+        }
+      }
+      return false;
+    }
 
-      // Copy data from currentBoard
-      this->tileSpaces = currentBoard.tileSpaces;
-      this->playerJustMoved = currentBoard.playerJustMoved;  // MCTS finds best possible move against this player
-      this->winningPlayer = currentBoard.winningPlayer;      // Should be -1
+    void workerLoop(int worker){
+      currentPool = this;
+      currentWorker = worker;
+      function<void()> task;
+      while (true){
+        if (this->takeTask(worker, task)){
+          task();
+          this->tasksRun ++;
+          continue;
+        }
+        if (this->stopping){
+          return;
+        }
+        // Nothing to do: sleep until a task is submitted (or briefly, in case the notification was missed)
+        chrono::steady_clock::time_point idleStart = chrono::steady_clock::now();
+        {
+          unique_lock<mutex> guard(this->sleepLock);
+          this->wakeUp.wait_for(guard, chrono::milliseconds(1));
+        }
+        this->idleMicroseconds += chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - idleStart).count();
+      }
+    }
+};
 
-      // Node being constructed is root, so previousBoard = nullptr
-      this->previousBoard = nullptr;
+thread_local WorkStealingPool* WorkStealingPool::currentPool = nullptr;
+thread_local int WorkStealingPool::currentWorker = -1;
 
-      // Initialize to default values
-      this->nextMove1 = nullptr;
-      this->nextMove2 = nullptr;
-      this->nextMove3 = nullptr;
-    }
+// Worker processes for Node::searchRootProcesses() (SearchSettings::processes)
+class ProcessWorkers {
+  /*
+  Forks worker processes that answer one request line at a time over a Unix domain socket pair.
+  Each worker runs handler(request) and writes back its result as one line. The coordinator sends every live worker its
+  request and collects the replies; a worker that dies (or doesn't answer in time) is killed, reaped and left out from then on.
+  Create it before starting any threads, fork() only copies the calling thread.
+  */
+  public:
+    vector<pid_t> pids;     // Process of each worker (-1 once retired)
 
-    // Constructor for creating children nodes
-    Node(Node* currentBoard, int playerNum) {
-      // Initialize accumulators to initial value (0)
-      this->ni = 0;
-      this->wi = 0;
-      this->di = 0;
+    ProcessWorkers(int numWorkers, function<string(const string&)> handler){
+      for (int w = 0; w < numWorkers; w++){
+        int ends[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, ends) != 0){
+          break;
+        }
+        pid_t pid = fork();
+        if (pid == 0){    // Worker: answer requests until the coordinator closes its end
+          for (int fd : this->sockets){
+            close(fd);    // Ends of the earlier workers' sockets, or those workers would never see EOF
+          }
+          close(ends[0]);
+          string request;
+          string buffer;
+          while (readLine(ends[1], buffer, request)){
+            string reply = handler(request) + "\n";
+            if (!writeAll(ends[1], reply)){
+              break;
+            }
+          }
+          _exit(0);   // Don't run the coordinator's exit handlers and destructors
+        }
+        close(ends[1]);
+        if (pid < 0){
+          close(ends[0]);
+          break;
+        }
+        this->pids.push_back(pid);
+        this->sockets.push_back(ends[0]);
+      }
+    }
 
-      // Copy data from currentBoard
-      this->tileSpaces = currentBoard->tileSpaces;
-      this->playerJustMoved = playerNum;
-      this->winningPlayer = currentBoard->winningPlayer;      // Should be -1
+    ~ProcessWorkers(){
+      for (size_t w = 0; w < this->pids.size(); w++){
+        if (this->pids[w] != -1){
+          close(this->sockets[w]);    // EOF makes the worker exit
+          waitpid(this->pids[w], nullptr, 0);
+        }
+      }
+    }
 
-      // Link to Node of previous game board
-      this->previousBoard = currentBoard;
+    // Number of workers forked
+    int size() const {
+      return this->pids.size();
+    }
 
-      // Initialize to default values
-      this->nextMove1 = nullptr;
-      this->nextMove2 = nullptr;
-      this->nextMove3 = nullptr;
+    // Number of workers still answering
+    int alive() const {
+      return count_if(this->pids.begin(), this->pids.end(), [](pid_t pid){ return pid != -1; });
     }
 
-    // TODO Class constructor or operator>> overload (for input from text file)
-    // friend ifstream &operator>>(ifstream &input, Date& t){
-    //   return input;
-    // }
+    // Sends requests[w] to worker w and returns its reply ("" for a worker that is or became dead), timeoutMs < 0 waits forever
+    vector<string> exchange(const vector<string>& requests, int timeoutMs){
+      vector<string> replies(this->size());
+      vector<string> buffers(this->size());
+      vector<bool> waiting(this->size(), false);
+      for (int w = 0; w < this->size(); w++){
+        if (this->pids[w] != -1 && !writeAll(this->sockets[w], requests[w] + "\n")){
+          this->retire(w);
+        }
+        waiting[w] = this->pids[w] != -1;
+      }
 
-    friend ostream &operator<<(ostream &output, const Node& obj){
-      string rows = "012345";
-      string columns = "0123456";
-      for (int i = 0; i < obj.tileSpaces.size(); i++) {        // For each row
-        output << rows[i] << " |";
-        for (int j = 0; j < obj.tileSpaces[i].size(); j++) {   // For each column
-          if (obj.tileSpaces[i][j] == -1) {
-            output << setw(4) << ".";
+      chrono::steady_clock::time_point deadline = chrono::steady_clock::now() + chrono::milliseconds(max(timeoutMs, 0));
+      while (count(waiting.begin(), waiting.end(), true) > 0){
+        vector<pollfd> fds;
+        vector<int> workers;
+        for (int w = 0; w < this->size(); w++){
+          if (waiting[w]){
+            fds.push_back({this->sockets[w], POLLIN, 0});
+            workers.push_back(w);
           }
-          else if (obj.tileSpaces[i][j] == 1) {
-            output << setw(4) << "R";
+        }
+        int wait = -1;
+        if (timeoutMs >= 0){
+          wait = max(0, static_cast<int>(chrono::duration_cast<chrono::milliseconds>(deadline - chrono::steady_clock::now()).count()));
+        }
+        int ready = poll(fds.data(), fds.size(), wait);
+        if (ready < 0 && errno == EINTR){
+          continue;
+        }
+        if (ready <= 0){    // Timed out (or poll failed): give up on everyone still thinking
+          for (int w : workers){
+            this->retire(w);
+            waiting[w] = false;
           }
-          else if (obj.tileSpaces[i][j] == 2) {
-            output << setw(4) << "Y";
+          break;
+        }
+        for (size_t k = 0; k < fds.size(); k++){
+          int w = workers[k];
+          if (fds[k].revents == 0){
+            continue;
+          }
+          char chunk[4096];
+          ssize_t bytes = read(fds[k].fd, chunk, sizeof(chunk));
+          if (bytes <= 0){    // The worker died
+            this->retire(w);
+            waiting[w] = false;
+            continue;
+          }
+          buffers[w].append(chunk, bytes);
+          size_t end = buffers[w].find('\n');
+          if (end != string::npos){
+            replies[w] = buffers[w].substr(0, end);
+            waiting[w] = false;
           }
         }
-        output << endl;
       }
-      output << "--|----------------------------" << endl << "  |";
-      for (int i = 0; i < columns.length(); i++){
-        output << setw(4) << columns[i];
+      return replies;
+    }
+
+  private:
+    vector<int> sockets;    // Coordinator's end of each worker's socket pair
+
+    void retire(int w){
+      if (this->pids[w] == -1){
+        return;
       }
-      output << endl;
-      return output;
+      kill(this->pids[w], SIGKILL);
+      waitpid(this->pids[w], nullptr, 0);
+      close(this->sockets[w]);
+      this->pids[w] = -1;
     }
 
-    bool operator==(const Node& rhs) {        // p1.operator==(p2)
-      return this->tileSpaces == rhs.tileSpaces;
+    // Reads up to the next newline (buffer keeps whatever was read past it), returns false on EOF
+    static bool readLine(int fd, string& buffer, string& line){
+      size_t end;
+      while ((end = buffer.find('\n')) == string::npos){
+        char chunk[4096];
+        ssize_t bytes = read(fd, chunk, sizeof(chunk));
+        if (bytes < 0 && errno == EINTR){
+          continue;
+        }
+        if (bytes <= 0){
+          return false;
+        }
+        buffer.append(chunk, bytes);
+      }
+      line = buffer.substr(0, end);
+      buffer.erase(0, end + 1);
+      return true;
     }
 
-    bool operator!=(const Node& rhs) {
-      return not (this == &rhs);
+    static bool writeAll(int fd, const string& data){
+      size_t written = 0;
+      while (written < data.size()){
+        ssize_t bytes = send(fd, data.data() + written, data.size() - written, MSG_NOSIGNAL);   // A dead reader is an error, not SIGPIPE
+        if (bytes < 0 && errno == EINTR){
+          continue;
+        }
+        if (bytes <= 0){
+          return false;
+        }
+        written += static_cast<size_t>(bytes);    // Positive here
+      }
+      return true;
     }
+};
 
-    Node& operator= (const Node& rhs) {       // p1 = p2
-      this->ni = rhs.ni;
-      this->wi = rhs.wi;
-      this->di = rhs.di;
+// When Node::makeMove() stops searching (any limit that is reached stops the search, -1 means no limit)
+class SearchLimits {
+  public:
+    long long maxPlayouts;    // Number of playouts (one per iteration of the search)
+    long long maxNodes;       // Number of positions created (in the tree and in playouts)
+    bool useDeadline;
+    chrono::steady_clock::time_point deadline;
+    int clockCheckInterval;   // The clock is only read every clockCheckInterval playouts
+    const atomic<bool> *stopFlag;   // The search stops as soon as this is set (optional, checked every playout)
 
-      // Copy data from currentBoard
-      this->tileSpaces = rhs.tileSpaces;
-      this->playerJustMoved = rhs.playerJustMoved;
-      this->winningPlayer = rhs.winningPlayer;      // Should be -1
+    // No limits: the search only stops once the root is proven, so only use this with SearchSettings::useSolver
+    SearchLimits(){
+      this->maxPlayouts = -1;
+      this->maxNodes = -1;
+      this->useDeadline = false;
+      this->clockCheckInterval = 64;
+      this->stopFlag = nullptr;
+    }
 
-      // Link to Node of previous game board
-      this->previousBoard = rhs.previousBoard;
+    static SearchLimits playouts(long long maxPlayouts){
+      SearchLimits limits;
+      limits.maxPlayouts = maxPlayouts;
+      return limits;
+    }
 
-      return *this;
+    static SearchLimits nodes(long long maxNodes){
+      SearchLimits limits;
+      limits.maxNodes = maxNodes;
+      return limits;
     }
 
-    // Creates a node that is the result of a move made in currentNode (provides linking)
-    Node getChildNode(int colNum) {
-      /*
-      Returns a Node with the most recent move (and a pointer to previous boards)
-      */
-      int currentPlayer;
-      if (playerJustMoved == -1){
-        currentPlayer = 1;
+    static SearchLimits until(chrono::steady_clock::time_point deadline){
+      SearchLimits limits;
+      limits.useDeadline = true;
+      limits.deadline = deadline;
+      return limits;
+    }
+
+    // Returns true once any limit has been reached
+    bool reached(long long playoutCount, long long nodeCount) const {
+      if (this->stopFlag != nullptr && this->stopFlag->load(memory_order_relaxed)){
+        return true;
       }
-      else {
-          currentPlayer = 3 - this->playerJustMoved;   // Get the number of the player currently playing
+      if (this->maxPlayouts >= 0 && playoutCount >= this->maxPlayouts){
+        return true;
+      }
+      if (this->maxNodes >= 0 && nodeCount >= this->maxNodes){
+        return true;
+      }
+      if (this->useDeadline && playoutCount % this->clockCheckInterval == 0 && chrono::steady_clock::now() >= this->deadline){
+        return true;
       }
+      return false;
+    }
+};
 
-      Node child(this, currentPlayer);   // Create a new board with a pointer back to the current state and the currentPlayer
+class OpeningBook;    // Defined after the solver, which builds it
+class Tablebase;
 
-      // Figure out which child is being created
-      if (this->nextMove1 == nullptr){
-        this->nextMove1 = &child;
-      }
-      else if (this->nextMove2 == nullptr){
-        this->nextMove2 = &child;
+// Options used by Node::makeMove()
+class SearchSettings {
+  public:
+    bool useTranspositions;       // Run UCT over a DAG of positions stored in a TranspositionTable (false = flat sampling of each column)
+    int iterations;               // Number of playouts per move when makeMove() is not given SearchLimits
+    double explorationConstant;   // Exploration constant for UCT selection
+    bool useSolver;               // Propagate proven wins/losses (MCTS-Solver) and stop early once the root is proven
+    bool useSequentialHalving;    // Split the playout budget between root moves by sequential halving instead of evenly (or by UCT)
+    bool useRave;                 // Blend all-moves-as-first statistics into selection
+    double raveEquivalence;       // Number of visits at which UCT and AMAF values get equal weight
+    int tableSizeMB;              // Size of the table created when table == nullptr (and of each thread's table)
+    TranspositionTable *table;    // Table kept between moves (optional, only used by the first thread)
+    LocklessTranspositionTable *sharedTable;   // Table shared by every thread's search (optional, used instead of table)
+    int threads;                  // Number of independent searches run at once (root parallelism)
+    WorkStealingPool *pool;       // Runs parallel searches as pool tasks instead of starting threads for every move (optional)
+    ProcessWorkers *processes;    // Runs the root parallel searches in worker processes instead (optional, see Node::answerSearchRequest())
+    int playoutsPerTask;          // Size of the playout tasks flat sampling is split into when a pool is used
+    bool useSharedTree;           // Threads search one shared tree instead of independent ones (no table, solver or RAVE)
+    int maxTreeNodes;             // Size limit for the shared tree (playouts start from the leaf once it is full)
+    int shardDepth;               // Shared tree nodes this close to the root keep one set of counters per thread (0 = none)
+    bool verbose;                 // Print the estimates for every move
+    int solverEmpties;            // makeMove() solves positions with this many empty cells or fewer exactly instead of searching (-1 = never)
+    int solverTableMB;            // Size of the solver's table
+    bool solverWeak;              // makeMove() only proves wins/draws/losses instead of finding the fastest win
+    const OpeningBook *book;      // Moves for the positions it contains (optional)
+    const Tablebase *tablebase;   // Exact results for makeMove() and the end of playouts (optional)
+    int leafSolverEmpties;        // With useSolver, new DAG leaves with this many empty cells or fewer are solved exactly (-1 = from the budget, see Node::leafSolverThreshold(), 0 = never)
+    bool deterministic;           // Reproducible search: fixed work per thread, seeded from seed and the position (see Node::searchDeterministic())
+    unsigned seed;                // Master seed for deterministic searches
+    bool pondered;                // The table's current search was started by a Ponderer on this position: it is continued instead of starting a new one (newSearch()), so the pondered entries aren't the oldest
+
+    SearchSettings(){
+      this->useTranspositions = true;
+      this->iterations = 10000;
+      this->explorationConstant = 1.4;
+      this->useSolver = true;
+      this->useSequentialHalving = false;
+      this->useRave = false;
+      this->raveEquivalence = 300;
+      this->tableSizeMB = 16;
+      this->table = nullptr;
+      this->sharedTable = nullptr;
+      this->threads = 1;
+      this->pool = nullptr;
+      this->processes = nullptr;
+      this->playoutsPerTask = 16;
+      this->useSharedTree = false;
+      this->maxTreeNodes = 1000000;
+      this->shardDepth = 2;
+      this->verbose = true;
+      this->solverEmpties = 24;
+      this->solverTableMB = 16;
+      this->solverWeak = true;
+      this->book = nullptr;
+      this->tablebase = nullptr;
+      this->leafSolverEmpties = -1;
+      this->deterministic = false;
+      this->seed = 1;
+      this->pondered = false;
+    }
+};
+
+// One thread's counters for a SharedTreeNode, alone on its cache line so threads never write to the same line
+class alignas(64) CounterShard {
+  public:
+    atomic<int> ni;
+    atomic<int> wi;
+    atomic<int> di;
+    atomic<int> virtualLoss;
+
+    CounterShard(){
+      this->ni = 0;
+      this->wi = 0;
+      this->di = 0;
+      this->virtualLoss = 0;
+    }
+
+    // Only the owning thread writes, so a plain load and store is enough (no locked read-modify-write)
+    static void increment(atomic<int>& counter, int amount){
+      counter.store(counter.load(memory_order_relaxed) + amount, memory_order_relaxed);
+    }
+};
+
+// Node of the tree searched by every thread at once in shared tree search (SearchSettings::useSharedTree)
+class SharedTreeNode {
+  /*
+  Every thread near the root updates the same few nodes, so nodes at the upper levels can be sharded: each thread updates
+  its own CounterShard and readers add up the shards. Deeper nodes are rarely shared and use the single set of counters.
+  */
+  public:
+    atomic<int> ni;   // Number of playouts through this node
+    atomic<int> wi;   // Number of those playouts won by the player who just moved into this position
+    atomic<int> di;   // Number of those playouts that were draws
+    atomic<int> virtualLoss;    // Threads currently searching below this node (counted as lost playouts during selection)
+    array<atomic<SharedTreeNode*>, 7> children;   // Set once by compare-and-swap, so expansion needs no lock
+    unique_ptr<CounterShard[]> shards;    // One per thread, used instead of the counters above when set
+    int numShards;
+
+    SharedTreeNode(int numShards = 0){
+      this->ni = 0;
+      this->wi = 0;
+      this->di = 0;
+      this->virtualLoss = 0;
+      for (int i = 0; i < 7; i++){
+        this->children[i] = nullptr;
       }
-      else if (this->nextMove3 == nullptr){
-        this->nextMove3 = &child;
+      this->numShards = numShards;
+      if (numShards > 0){
+        this->shards.reset(new CounterShard[numShards]);
       }
+    }
 
-      // Iterate through tileSpaces[i][colNum] backwards until tileSpaces[i][i] == -1, then tileSpaces[rowNum][colNum] = currentPlayer
-      for (int i = 5; i >= 0; i--) {   // Starting at the bottom of the row and working to the top
-        if (child.tileSpaces[i][colNum] == -1) {   // If the current tile has no token yet
-          child.tileSpaces[i][colNum] = currentPlayer;
-          break;  // Break out of loop when move has been made
-        }
+    ~SharedTreeNode(){
+      for (int i = 0; i < 7; i++){
+        delete this->children[i].load();
       }
-      //cout << child;  // For test purposes
-      return child;
     }
 
-    // Checks the validity of making a move in a given column
-    bool isPossible(int colNum){    // currentBoard.isPossible(int)
-      /*
-      Returns True the specified column still has empty spaces, returns False if it is full
-      */
-      for (int i = 0; i < this->tileSpaces.size(); i++){      // For each row
-        if (this->tileSpaces[i][colNum] == -1){   // Executes as soon as an available move is found
-          return true;
-        }
-      }
+    int visits() const {
+      return this->sum(&CounterShard::ni, this->ni);
+    }
 
-      return false;
+    int wins() const {
+      return this->sum(&CounterShard::wi, this->wi);
     }
 
-    // Returns a number indicating state of game (win/lose/draw/in play)
-    int getGameState(){    // currentBoard.getGameState()
-      /*
-      Possible Return Values:
-      -1: game in progress, no winner yet
-      1: Red has won!
-      2: Yellow has won!
-      3: Game is a draw.
-      */
+    int draws() const {
+      return this->sum(&CounterShard::di, this->di);
+    }
 
-      // If there are four vertical tokens
-      for (int i = 0; i + 3 < this->tileSpaces.size(); i++) {     // For each row
-        for (int j = 0; j < this->tileSpaces[i].size(); j++) {      // For each column
-          if (this->tileSpaces[i][j] != -1 && this->tileSpaces[i][j] == this->tileSpaces[i + 1][j] && this->tileSpaces[i][j] == this->tileSpaces[i + 2][j] && this->tileSpaces[i][j] == this->tileSpaces[i + 3][j]){
-            return this->tileSpaces[i][j];
-          }
-        }
-      }
+    int inFlight() const {
+      return this->sum(&CounterShard::virtualLoss, this->virtualLoss);
+    }
 
-      // If there are four horizontal tokens
-      for (int i = 0; i < this->tileSpaces.size(); i++) {     // For each row
-        for (int j = 0; j + 3 < this->tileSpaces[i].size(); j++) {      // For each column
-          if (this->tileSpaces[i][j] != -1 && this->tileSpaces[i][j] == this->tileSpaces[i][j + 1] && this->tileSpaces[i][j] == this->tileSpaces[i][j + 2] && this->tileSpaces[i][j] == this->tileSpaces[i][j + 3]){
-            return this->tileSpaces[i][j];
-          }
-        }
+    // Thread t starts (amount = 1) or finishes (amount = -1) searching below this node
+    void addVirtualLoss(int t, int amount){
+      if (this->numShards > 0){
+        CounterShard::increment(this->shards[t].virtualLoss, amount);
+      }
+      else{
+        this->virtualLoss.fetch_add(amount, memory_order_relaxed);
       }
+    }
 
-      // If there are four diagonal tokens L->R descending
-      for (int i = 0; i + 3 < this->tileSpaces.size(); i++) {     // For each row
-        for (int j = 0; j + 3 < this->tileSpaces[i].size(); j++) {      // For each column
-          if (this->tileSpaces[i][j] != -1 && this->tileSpaces[i][j] == this->tileSpaces[i + 1][j + 1] && this->tileSpaces[i][j] == this->tileSpaces[i + 2][j + 2] && this->tileSpaces[i][j] == this->tileSpaces[i + 3][j + 3]){
-            return this->tileSpaces[i][j];
-          }
+    // Thread t records one playout through this node
+    void addResult(int t, bool won, bool drawn){
+      if (this->numShards > 0){
+        CounterShard& shard = this->shards[t];
+        CounterShard::increment(shard.ni, 1);
+        CounterShard::increment(shard.wi, won);
+        CounterShard::increment(shard.di, drawn);
+      }
+      else{
+        this->ni.fetch_add(1, memory_order_relaxed);
+        if (won){
+          this->wi.fetch_add(1, memory_order_relaxed);
+        }
+        else if (drawn){
+          this->di.fetch_add(1, memory_order_relaxed);
         }
       }
+    }
 
-      // If there are four diagonal tokens R->L descending
-      for (int i = 0; i + 3 < this->tileSpaces.size(); i++) {     // For each row
-        for (int j = tileSpaces[i].size(); j >= 3; j--) {           // For each column
-          if (this->tileSpaces[i][j] != -1 && this->tileSpaces[i][j] == this->tileSpaces[i + 1][j - 1] && this->tileSpaces[i][j] == this->tileSpaces[i + 2][j - 2] && this->tileSpaces[i][j] == this->tileSpaces[i + 3][j - 3]){
-            return this->tileSpaces[i][j];
-          }
-        }
+  private:
+    int sum(atomic<int> CounterShard::* counter, const atomic<int>& unsharded) const {
+      if (this->numShards == 0){
+        return unsharded.load(memory_order_relaxed);
       }
+      int total = 0;
+      for (int t = 0; t < this->numShards; t++){
+        total += (this->shards[t].*counter).load(memory_order_relaxed);
+      }
+      return total;
+    }
+};
 
-      // If board an empty spaces remain in the board
-      for (int i = 0; i < this->tileSpaces.size(); i++) {        // For each row
-        for (int j = 0; j < this->tileSpaces[i].size(); j++) {   // For each column
-          if (this->tileSpaces[i][j] == -1){  // This will only execute if there are any valid moves left to make
-            return -1;
+// Counters reported by shared tree search
+class SharedTreeCounters {
+  public:
+    alignas(64) atomic<long long> playouts;   // Playouts claimed by the threads (on its own cache line, it is updated every playout)
+    alignas(64) atomic<long long> nodes;      // Nodes added to the tree
+    atomic<long long> expansionCollisions;    // Another thread expanded the same child first (compare-and-swap failed)
+    atomic<long long> virtualLossHits;        // Selection looked at a child another thread was searching (contention, added up when each thread finishes)
+
+    SharedTreeCounters(){
+      this->playouts = 0;
+      this->nodes = 0;
+      this->expansionCollisions = 0;
+      this->virtualLossHits = 0;
+    }
+};
+
+// Statistics for each move from the root position (what makeMove() chooses from). Searches run on other threads are merged with add()
+class RootStatistics {
+  public:
+    array<long long, 7> ni;     // Playouts through each column
+    array<long long, 7> wi;     // How many of them the player to move at the root won
+    array<long long, 7> di;     // How many of them were draws
+    array<int, 7> provenValue;  // 1 = proven win, -1 = proven loss, 0 = not proven (or a proven draw) for the player to move
+    array<int, 7> provenDepth;  // Plies until the game ends after the move (when proven)
+    int halvingChoice;          // Column chosen by sequential halving (-1 if not used)
+    long long playouts;         // Number of playouts run by the search
+
+    RootStatistics(){
+      this->ni.fill(0);
+      this->wi.fill(0);
+      this->di.fill(0);
+      this->provenValue.fill(0);
+      this->provenDepth.fill(0);
+      this->halvingChoice = -1;
+      this->playouts = 0;
+    }
+
+    // Merges the statistics of another search (merged statistics are chosen from by playouts, not by sequential halving)
+    void add(const RootStatistics& other){
+      for (int i = 0; i < 7; i++){
+        this->ni[i] += other.ni[i];
+        this->wi[i] += other.wi[i];
+        this->di[i] += other.di[i];
+
+        // Proofs are exact, keep the fastest win / slowest loss found by any search
+        if (other.provenValue[i] != 0){
+          bool better = this->provenValue[i] == 0;
+          if (!better && other.provenValue[i] == 1){
+            better = other.provenDepth[i] < this->provenDepth[i];
+          }
+          else if (!better){
+            better = other.provenDepth[i] > this->provenDepth[i];
+          }
+          if (better){
+            this->provenValue[i] = other.provenValue[i];
+            this->provenDepth[i] = other.provenDepth[i];
           }
         }
       }
-
-      // If none of the above returns are triggered
-      return 3;
+      this->halvingChoice = -1;
+      this->playouts += other.playouts;
     }
+};
 
-    // Return the number of empty spaces in game board
-    int movesLeft(){
+// Connect Four position as two bitboards, for the exact solver
+class BitboardPosition {
+  /*
+  Bit col * 7 + h is the cell h rows above the bottom of column col (bit 6 of each column stays empty as a separator,
+  so shifting by 1, 6, 7 and 8 follows the four directions without wrapping).
+  current holds the stones of the player to move, mask every stone; current + mask is a unique key for the position.
+  */
+  public:
+    static const int WIDTH = 7;
+    static const int HEIGHT = 6;
+    static const int MIN_SCORE = -(WIDTH * HEIGHT) / 2 + 3;   // Losing to the opponent's 4th stone
+    static const int MAX_SCORE = (WIDTH * HEIGHT + 1) / 2 - 3;  // Winning with the 4th stone
+
+    uint64_t current;   // Stones of the player to move
+    uint64_t mask;      // Every stone
+    int moves;          // Stones played
+
+    BitboardPosition(){
+      this->current = 0;
+      this->mask = 0;
+      this->moves = 0;
+    }
+
+    // tiles[0] is the top row (as in c4Board and Node), playerToMove is 1 or 2
+    BitboardPosition(const array<array<int, 7>, 6>& tiles, int playerToMove){
+      this->current = 0;
+      this->mask = 0;
+      this->moves = 0;
+      for (int row = 0; row < HEIGHT; row++){
+        for (int col = 0; col < WIDTH; col++){
+          if (tiles[row][col] == -1){
+            continue;
+          }
+          uint64_t cell = UINT64_C(1) << (col * (HEIGHT + 1) + HEIGHT - 1 - row);
+          this->mask |= cell;
+          if (tiles[row][col] == playerToMove){
+            this->current |= cell;
+          }
+          this->moves ++;
+        }
+      }
+    }
+
+    bool canPlay(int col) const {
+      return (this->mask & topMask(col)) == 0;
+    }
+
+    void play(int col){
+      this->playMove((this->mask + bottomMask(col)) & columnMask(col));
+    }
+
+    // Plays the move given as the bitmap of the cell it fills
+    void playMove(uint64_t move){
+      this->current ^= this->mask;    // The other player is to move
+      this->mask |= move;
+      this->moves ++;
+    }
+
+    // Would playing col connect four for the player to move?
+    bool isWinningMove(int col) const {
+      return this->winningPosition() & this->possible() & columnMask(col);
+    }
+
+    bool canWinNext() const {
+      return this->winningPosition() & this->possible();
+    }
+
+    uint64_t key() const {
+      return this->current + this->mask;
+    }
+
+    // Moves (as cell bitmaps) that don't let the opponent win on the next move, 0 if every move loses
+    uint64_t possibleNonLosingMoves() const {
+      uint64_t possibleMask = this->possible();
+      uint64_t opponentWin = this->opponentWinningPosition();
+      uint64_t forced = possibleMask & opponentWin;
+      if (forced){
+        if (forced & (forced - 1)){   // Two threats can't both be blocked
+          return 0;
+        }
+        possibleMask = forced;
+      }
+      return possibleMask & ~(opponentWin >> 1);    // Don't play below an opponent's threat
+    }
+
+    // Number of cells the player to move would threaten after playing move (used to order moves)
+    int moveScore(uint64_t move) const {
+      return __builtin_popcountll(winningCells(this->current | move, this->mask));
+    }
+
+    static uint64_t columnMask(int col){
+      return ((UINT64_C(1) << HEIGHT) - 1) << (col * (HEIGHT + 1));
+    }
+
+    // The position with the given key()
+    static BitboardPosition fromKey(uint64_t key){
+      uint64_t marked = key + bottomRows();   // Each column: a 1 above its stones, the stones of the player to move below it
+      BitboardPosition position;
+      for (int col = 0; col < WIDTH; col++){
+        uint64_t column = (marked >> (col * (HEIGHT + 1))) & ((UINT64_C(1) << (HEIGHT + 1)) - 1);
+        int height = 63 - __builtin_clzll(column);
+        position.mask |= ((UINT64_C(1) << height) - 1) << (col * (HEIGHT + 1));
+      }
+      position.current = marked & position.mask;
+      position.moves = __builtin_popcountll(position.mask);
+      return position;
+    }
+
+    // Key of the position with the columns in reverse order (each column's part of the key only depends on that column)
+    uint64_t mirroredKey() const {
+      uint64_t key = this->key();
+      uint64_t mirrored = 0;
+      for (int col = 0; col < WIDTH; col++){
+        uint64_t column = (key >> (col * (HEIGHT + 1))) & ((UINT64_C(1) << (HEIGHT + 1)) - 1);
+        mirrored |= column << ((WIDTH - 1 - col) * (HEIGHT + 1));
+      }
+      return mirrored;
+    }
+
+    // Same key for a position and its mirror image, mirrored is set if the mirror image's key was used
+    uint64_t canonicalKey(bool& mirrored) const {
+      uint64_t key = this->key();
+      uint64_t other = this->mirroredKey();
+      mirrored = other < key;
+      return min(key, other);
+    }
+
+  private:
+    static uint64_t topMask(int col){
+      return UINT64_C(1) << (HEIGHT - 1 + col * (HEIGHT + 1));
+    }
+
+    static uint64_t bottomMask(int col){
+      return UINT64_C(1) << (col * (HEIGHT + 1));
+    }
+
+    static uint64_t bottomRows(){
+      uint64_t bottom = 0;
+      for (int col = 0; col < WIDTH; col++){
+        bottom |= bottomMask(col);
+      }
+      return bottom;
+    }
+
+    static uint64_t boardMask(){
+      return bottomRows() * ((UINT64_C(1) << HEIGHT) - 1);
+    }
+
+    // Cells that can be played next
+    uint64_t possible() const {
+      return (this->mask + bottomRows()) & boardMask();
+    }
+
+    uint64_t winningPosition() const {
+      return winningCells(this->current, this->mask);
+    }
+
+    uint64_t opponentWinningPosition() const {
+      return winningCells(this->current ^ this->mask, this->mask);
+    }
+
+    // Empty cells that would complete four in a row for the player owning stones
+    static uint64_t winningCells(uint64_t stones, uint64_t mask){
+      // Vertical
+      uint64_t r = (stones << 1) & (stones << 2) & (stones << 3);
+
+      // Horizontal and both diagonals (shift = HEIGHT + 1, HEIGHT, HEIGHT + 2)
+      for (int shift : {HEIGHT + 1, HEIGHT, HEIGHT + 2}){
+        uint64_t p = (stones << shift) & (stones << 2 * shift);
+        r |= p & (stones << 3 * shift);   // Three on the left
+        r |= p & (stones >> shift);       // Two on the left, one on the right
+        p = (stones >> shift) & (stones >> 2 * shift);
+        r |= p & (stones >> 3 * shift);   // Three on the right
+        r |= p & (stones << shift);       // Two on the right, one on the left
+      }
+      return r & (boardMask() ^ mask);
+    }
+};
+
+// Dense numbering of the positions with a given number of stones added to a base position (below the empty board: of
+// every position with that many stones), and its inverse
+class PositionRanking {
+  /*
+  rank = heights rank * C(added, own) + colours rank, where own = (added + 1) / 2 is how many of the added stones belong
+  to the base's player to move (who plays first). The heights added to the columns are ranked in lexicographic order
+  by counting, with ways[col][stones], how many ways columns col to 6 can take the stones left. The added stones,
+  column by column from the bottom up, are ranked by which of them are own with the combinatorial number system.
+  Every rank is a position with the right number of stones of each colour, so positions that can't come up in a game
+  (four already connected, no possible move order) have ranks too.
+  */
+  public:
+    PositionRanking(const BitboardPosition& base = BitboardPosition()){
+      const int WIDTH = BitboardPosition::WIDTH;
+      this->base = base;
+      for (int n = 0; n <= 42; n++){
+        for (int k = 0; k <= 42; k++){
+          this->choose[n][k] = binomial(n, k);
+        }
+      }
+      for (int col = 0; col < WIDTH; col++){
+        this->baseHeight[col] = __builtin_popcountll(base.mask & BitboardPosition::columnMask(col));
+      }
+      for (int stones = 0; stones <= 42; stones++){
+        this->ways[WIDTH][stones] = (stones == 0) ? 1 : 0;
+      }
+      for (int col = WIDTH - 1; col >= 0; col--){
+        int room = BitboardPosition::HEIGHT - this->baseHeight[col];
+        for (int stones = 0; stones <= 42; stones++){
+          uint64_t total = 0;
+          for (int height = 0; height <= BitboardPosition::HEIGHT; height++){
+            this->below[col][stones][height] = total;   // Ranks taken by the smaller heights of col
+            if (height <= min(room, stones)){
+              total += this->ways[col + 1][stones - height];
+            }
+          }
+          this->ways[col][stones] = total;
+        }
+      }
+    }
+
+    // Number of ranks of positions with added stones more than the base
+    uint64_t size(int added) const {
+      const int cells = BitboardPosition::WIDTH * BitboardPosition::HEIGHT;
+      if (added < 0 || added > cells || added > cells - this->base.moves){   // The first bound keeps the indices within the tables
+        return 0;
+      }
+      return this->ways[0][added] * this->choose[added][(added + 1) / 2];
+    }
+
+    // Does position have the base's stones?
+    bool extends(const BitboardPosition& position) const {
+      return position.moves >= this->base.moves && (position.mask & this->base.mask) == this->base.mask && (ownStones(position) & this->base.mask) == this->base.current;
+    }
+
+    // Rank of position among those with as many stones (position must extend the base)
+    uint64_t rank(const BitboardPosition& position) const {
+      int added = position.moves - this->base.moves;
+      uint64_t own = ownStones(position);
+      uint64_t heightsRank = 0;
+      uint64_t coloursRank = 0;
+      int left = added;
+      int index = 0;    // Of the added stone
+      int taken = 0;    // Own stones so far
+      for (int col = 0; col < BitboardPosition::WIDTH; col++){
+        int height = __builtin_ctzll(~(position.mask >> (col * (BitboardPosition::HEIGHT + 1)))) - this->baseHeight[col];   // Stones are at the bottom
+        heightsRank += this->below[col][left][height];
+        left -= height;
+        uint64_t ownAdded = (own >> (col * (BitboardPosition::HEIGHT + 1) + this->baseHeight[col])) & ((UINT64_C(1) << height) - 1);
+        for (; ownAdded != 0; ownAdded &= ownAdded - 1){
+          taken ++;
+          coloursRank += this->choose[index + __builtin_ctzll(ownAdded)][taken];
+        }
+        index += height;
+      }
+      return heightsRank * this->choose[added][(added + 1) / 2] + coloursRank;
+    }
+
+    // Position with added stones more than the base at rank (rank < size(added))
+    BitboardPosition unrank(int added, uint64_t rank) const {
+      int ownCount = (added + 1) / 2;
+      uint64_t heightsRank = rank / this->choose[added][ownCount];
+      uint64_t coloursRank = rank % this->choose[added][ownCount];
+      array<uint64_t, 42> cells;    // Of the added stones, in rank() order
+      uint64_t mask = this->base.mask;
+      int index = 0;
+      int left = added;
+      for (int col = 0; col < BitboardPosition::WIDTH; col++){
+        int room = min(BitboardPosition::HEIGHT - this->baseHeight[col], left);
+        int height = 0;
+        while (height < room && this->below[col][left][height + 1] <= heightsRank){
+          height ++;
+        }
+        heightsRank -= this->below[col][left][height];
+        left -= height;
+        for (int row = this->baseHeight[col]; row < this->baseHeight[col] + height; row++){
+          cells[index ++] = UINT64_C(1) << (col * (BitboardPosition::HEIGHT + 1) + row);
+          mask |= cells[index - 1];
+        }
+      }
+      uint64_t own = this->base.current;
+      for (int i = added - 1, taken = ownCount; i >= 0 && taken > 0; i--){
+        if (coloursRank >= this->choose[i][taken]){
+          coloursRank -= this->choose[i][taken];
+          own |= cells[i];
+          taken --;
+        }
+      }
+      BitboardPosition position;
+      position.mask = mask;
+      position.current = (added % 2 == 0) ? own : own ^ mask;
+      position.moves = this->base.moves + added;
+      return position;
+    }
+
+    static uint64_t binomial(int n, int k){
+      static const vector<vector<uint64_t>> table = [](){
+        vector<vector<uint64_t>> pascal(43, vector<uint64_t>(43, 0));
+        for (int i = 0; i <= 42; i++){
+          pascal[i][0] = 1;
+          for (int j = 1; j <= i; j++){
+            pascal[i][j] = pascal[i - 1][j - 1] + pascal[i - 1][j];
+          }
+        }
+        return pascal;
+      }();
+      return (k < 0 || k > n) ? 0 : table[n][k];
+    }
+
+  private:
+    // Stones of the base's player to move
+    uint64_t ownStones(const BitboardPosition& position) const {
+      return ((position.moves - this->base.moves) % 2 == 0) ? position.current : position.current ^ position.mask;
+    }
+
+    BitboardPosition base;
+    int baseHeight[7];
+    uint64_t ways[8][43];       // ways[col][stones]: height vectors of columns col to 6 adding up to stones
+    uint64_t below[7][43][7];   // below[col][stones][height]: ranks before col's height is height, with stones left for columns col to 6
+    uint64_t choose[43][43];    // binomial() without the bounds checks
+};
+
+// Bounds on the scores of positions already solved (Solver)
+class SolverTable {
+  /*
+  Each entry is one 64-bit word: the low 32 bits of the position's key and a bound on its score (0 = empty).
+  A BitboardPosition key is less than 2^49 and the table size is a prime above 2^17, so by the Chinese remainder theorem
+  (key mod size, key mod 2^32) identifies the key: the stored part of the key can't match another position.
+  Entries are replaced whenever another position maps to the same slot. Reads and writes are single atomic words, so the
+  table can be shared by solver threads.
+  */
+  public:
+    unsigned long long numEntries;    // Prime
+
+    // Counters
+    atomic<long long> hits;
+    atomic<long long> misses;
+    atomic<long long> stores;
+
+    SolverTable(int sizeMB){
+      unsigned long long wanted = max((unsigned long long)sizeMB * 1024 * 1024 / sizeof(uint64_t), (1ULL << 17) + 30);
+      this->numEntries = wanted;
+      while (!isPrime(this->numEntries)){
+        this->numEntries --;
+      }
+      this->entries.reset(new atomic<uint64_t>[this->numEntries]);
+      this->clear();
+    }
+
+    void clear(){
+      for (unsigned long long i = 0; i < this->numEntries; i++){
+        this->entries[i].store(0, memory_order_relaxed);
+      }
+      this->hits = 0;
+      this->misses = 0;
+      this->stores = 0;
+    }
+
+    // Returns the value stored for key, 0 if there is none
+    int get(uint64_t key){
+      uint64_t entry = this->entries[key % this->numEntries].load(memory_order_relaxed);
+      if ((entry >> 32) == (key & 0xFFFFFFFF) && (entry & 0xFF) != 0){
+        this->hits.fetch_add(1, memory_order_relaxed);
+        return entry & 0xFF;
+      }
+      this->misses.fetch_add(1, memory_order_relaxed);
+      return 0;
+    }
+
+    // value must be in 1-255
+    void put(uint64_t key, int value){
+      this->entries[key % this->numEntries].store((key & 0xFFFFFFFF) << 32 | value, memory_order_relaxed);
+      this->stores.fetch_add(1, memory_order_relaxed);
+    }
+
+    double hitRate() const {
+      long long probes = this->hits + this->misses;
+      return probes == 0 ? 0.0 : static_cast<double>(this->hits) / probes;
+    }
+
+  private:
+    unique_ptr<atomic<uint64_t>[]> entries;
+
+    static bool isPrime(unsigned long long n){
+      if (n < 2){
+        return false;
+      }
+      for (unsigned long long d = 2; d * d <= n; d++){
+        if (n % d == 0){
+          return false;
+        }
+      }
+      return true;
+    }
+};
+
+// Exact solver: negamax with alpha-beta pruning over BitboardPosition
+class Solver {
+  /*
+  Scores are from the point of view of the player to move: 0 for a draw, positive for a win (22 minus the number of
+  stones the winner has played when connecting four, so faster wins score higher) and negative for a loss.
+  Moves are tried center first, then by the number of threats they create.
+  Bounds found are kept in a SolverTable (optional): upper bounds as score - MIN_SCORE + 1, lower bounds above that as
+  score - 2 * MIN_SCORE + MAX_SCORE + 2.
+  */
+  public:
+    long long nodeCount;    // Positions searched
+    SolverTable *table;
+    const atomic<bool> *stopFlag;   // Once set the search unwinds without storing anything (optional, see solveParallel())
+    const SearchLimits *limits;     // Stops the search like stopFlag once reached (optional, checked every LIMITS_INTERVAL positions)
+
+    // variant > 0 rotates the center first order of the columns, so that threads sharing a table search in different orders
+    Solver(SolverTable* table = nullptr, int variant = 0){
+      this->nodeCount = 0;
+      this->table = table;
+      this->stopFlag = nullptr;
+      this->limits = nullptr;
+      this->limitReached = false;
+      for (int i = 0; i < BitboardPosition::WIDTH; i++){
+        int k = (i + variant) % BitboardPosition::WIDTH;
+        this->columnOrder[i] = BitboardPosition::WIDTH / 2 + (1 - 2 * (k % 2)) * (k + 1) / 2;   // 3, 2, 4, 1, 5, 0, 6 for variant 0
+      }
+    }
+
+    bool stopped() const {
+      return this->limitReached || (this->stopFlag != nullptr && this->stopFlag->load(memory_order_relaxed));
+    }
+
+    // Lazy SMP: solves position on threads threads sharing table, returns the score found by the first thread to finish (INTERRUPTED if limits stop them all first)
+    static int solveParallel(const BitboardPosition& position, bool weak, int threads, SolverTable* table, long long* nodeCount = nullptr, const SearchLimits* limits = nullptr){
       /*
-      If movesLeft = 0, node is fully mapped.
-      If ni = fact(movesLeft), node is fully mapped. (or some similar expression)
+      Every thread solves the whole position with its own move order. They don't split the work, but each one finds bounds in
+      the shared table that the others then don't have to search for. A finished solve is exact, so the others are stopped.
       */
-      int acc = 0;    // Initialize accumulator to 0
+      atomic<bool> stop (false);
+      atomic<int> result (INTERRUPTED);
+      atomic<long long> nodes (0);
+      vector<thread> workers;
+      for (int t = 0; t < max(threads, 1); t++){
+        workers.push_back(thread([&, t](){
+          Solver solver(table, t);
+          solver.stopFlag = &stop;
+          solver.limits = limits;
+          int score = solver.solve(position, weak);
+          if (!solver.stopped() && !stop.exchange(true)){   // The first to finish
+            result = score;
+          }
+          nodes += solver.nodeCount;
+        }));
+      }
+      for (thread& worker : workers){
+        worker.join();
+      }
+      if (nodeCount != nullptr){
+        *nodeCount += nodes;
+      }
+      return result;
+    }
 
-      for (int i = 0; i < this->tileSpaces.size(); i++) {   // For each row
-        for (int j = 0; i < tileSpaces[i].size(); j++) {      // For each column
-          if (tileSpaces[i][j] == -1){      // If space is empty...
-            acc ++;   // ...increment accumulator.
+    // Exact score of a position that isn't over yet (weak: only its sign, 1 = win, 0 = draw, -1 = loss)
+    int solve(const BitboardPosition& position, bool weak = false){
+      /*
+      Binary search on the score with null window searches: negamax(position, med, med + 1) only tells whether the score is
+      above med, but prunes far more than a wide window. The table keeps the bounds found between iterations.
+      The first guesses are pulled towards 0, where most scores are.
+      */
+      const int cells = BitboardPosition::WIDTH * BitboardPosition::HEIGHT;
+      if (position.canWinNext()){
+        return weak ? 1 : (cells + 1 - position.moves) / 2;
+      }
+      int lowest = -(cells - position.moves) / 2;
+      int highest = (cells + 1 - position.moves) / 2;
+      if (weak){
+        lowest = -1;
+        highest = 1;
+      }
+      while (lowest < highest && !this->stopped()){
+        int med = lowest + (highest - lowest) / 2;
+        if (med <= 0 && lowest / 2 < med){
+          med = lowest / 2;
+        }
+        else if (med >= 0 && highest / 2 > med){
+          med = highest / 2;
+        }
+        int result = this->negamax(position, med, med + 1);
+        if (result <= med){
+          highest = result;
+        }
+        else{
+          lowest = result;
+        }
+      }
+      if (weak){
+        return (lowest > 0) - (lowest < 0);
+      }
+      return lowest;
+    }
+
+    // Score of each move from position (INVALID_MOVE for full columns, only the sign if weak)
+    array<int, 7> analyze(const BitboardPosition& position, bool weak = false){
+      array<int, 7> scores;
+      for (int col = 0; col < BitboardPosition::WIDTH; col++){
+        scores[col] = INVALID_MOVE;
+        if (!position.canPlay(col)){
+          continue;
+        }
+        if (position.isWinningMove(col)){
+          scores[col] = weak ? 1 : (BitboardPosition::WIDTH * BitboardPosition::HEIGHT + 1 - position.moves) / 2;
+        }
+        else{
+          BitboardPosition child = position;
+          child.play(col);
+          scores[col] = child.moves == BitboardPosition::WIDTH * BitboardPosition::HEIGHT ? 0 : -this->solve(child, weak);
+        }
+      }
+      return scores;
+    }
+
+    // Number of moves the winner still has to play (including the next one when the player to move wins), 0 for a draw
+    static int movesToEnd(const BitboardPosition& position, int score){
+      int stonesToWin = (BitboardPosition::WIDTH * BitboardPosition::HEIGHT) / 2 + 1 - abs(score);
+      if (score > 0){
+        return stonesToWin - position.moves / 2;
+      }
+      if (score < 0){
+        return stonesToWin - (position.moves + 1) / 2;
+      }
+      return 0;
+    }
+
+    static const int INVALID_MOVE = -1000;
+    static const int INTERRUPTED = -2000;
+    static const int LIMITS_INTERVAL = 4096;
+
+  private:
+    array<int, 7> columnOrder;
+    bool limitReached;
+
+    int negamax(const BitboardPosition& position, int alpha, int beta){
+      /*
+      position can't be won on this move. Returns the exact score if it is in (alpha, beta), otherwise a bound on the
+      same side of the window as the exact score
+      */
+      this->nodeCount ++;
+      if (this->limits != nullptr && this->nodeCount % LIMITS_INTERVAL == 0 && this->limits->reached(0, this->nodeCount)){
+        this->limitReached = true;
+        return alpha;   // Meaningless, the caller sees stopped()
+      }
+      const int cells = BitboardPosition::WIDTH * BitboardPosition::HEIGHT;
+      uint64_t next = position.possibleNonLosingMoves();
+      if (next == 0){   // The opponent wins on their next move
+        return -(cells - position.moves) / 2;
+      }
+      if (position.moves >= cells - 2){   // Nobody can win with the last two stones
+        return 0;
+      }
+
+      int lowest = -(cells - 2 - position.moves) / 2;   // The opponent can't win on their next move
+      if (alpha < lowest){
+        alpha = lowest;
+        if (alpha >= beta){
+          return alpha;
+        }
+      }
+      int highest = (cells - 1 - position.moves) / 2;   // The player to move can't win on this move
+      if (this->table != nullptr){
+        if (int value = this->table->get(position.key())){
+          if (value > BitboardPosition::MAX_SCORE - BitboardPosition::MIN_SCORE + 1){    // Lower bound
+            int lower = value + 2 * BitboardPosition::MIN_SCORE - BitboardPosition::MAX_SCORE - 2;
+            if (alpha < lower){
+              alpha = lower;
+              if (alpha >= beta){
+                return alpha;
+              }
+            }
+          }
+          else{
+            highest = min(highest, value + BitboardPosition::MIN_SCORE - 1);
           }
         }
       }
-      return acc;   // Return accumulator
+      if (beta > highest){
+        beta = highest;
+        if (alpha >= beta){
+          return beta;
+        }
+      }
+
+      // Order the moves: most threats first, center first among equals (insertion sort keeps the center order stable)
+      array<uint64_t, 7> moves;
+      array<int, 7> scores;
+      int count = 0;
+      for (int i = 0; i < BitboardPosition::WIDTH; i++){
+        uint64_t move = next & BitboardPosition::columnMask(this->columnOrder[i]);
+        if (!move){
+          continue;
+        }
+        int score = position.moveScore(move);
+        int k = count++;
+        for (; k > 0 && scores[k - 1] < score; k--){
+          moves[k] = moves[k - 1];
+          scores[k] = scores[k - 1];
+        }
+        moves[k] = move;
+        scores[k] = score;
+      }
+
+      for (int k = 0; k < count; k++){
+        BitboardPosition child = position;
+        child.playMove(moves[k]);
+        int score = -this->negamax(child, -beta, -alpha);
+        if (this->stopped()){   // score is meaningless
+          return alpha;
+        }
+        if (score >= beta){
+          if (this->table != nullptr){
+            this->table->put(position.key(), score + BitboardPosition::MAX_SCORE - 2 * BitboardPosition::MIN_SCORE + 2);
+          }
+          return score;
+        }
+        if (score > alpha){
+          alpha = score;
+        }
+      }
+      if (this->table != nullptr){
+        this->table->put(position.key(), alpha - BitboardPosition::MIN_SCORE + 1);
+      }
+      return alpha;
     }
+};
 
-    // Randomly play through game specified number of times, updating win, loss, or draw for the instance of Node the function is called from;
-    void sampleNodePath(int numSearches) {
+// Best move and score of positions near the start of the game, read from a file built by OpeningBook::build()
+class OpeningBook {
+  /*
+  File: "C4BOOK01", the number of entries (8 bytes), then the entries sorted in increasing order.
+  Entry: canonical key (BitboardPosition::canonicalKey(), 49 bits) << 10 | (score + 32) << 3 | best column, where the column
+  is for the canonical orientation. The file is memory mapped and searched by binary search on the key.
+  */
+  public:
+    OpeningBook(){
+      this->entries = nullptr;
+      this->count = 0;
+      this->mapping = nullptr;
+      this->mappingSize = 0;
+    }
+
+    ~OpeningBook(){
+      this->close();
+    }
+
+    // Maps the book file, returns false if it can't be read or isn't a book
+    bool open(const string& path){
+      this->close();
+      int fd = ::open(path.c_str(), O_RDONLY);
+      if (fd < 0){
+        return false;
+      }
+      struct stat info;
+      if (fstat(fd, &info) != 0 || info.st_size < 16){
+        ::close(fd);
+        return false;
+      }
+      void* mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+      ::close(fd);    // The mapping stays valid
+      if (mapping == MAP_FAILED){
+        return false;
+      }
+      const char* bytes = static_cast<const char*>(mapping);
+      uint64_t count;
+      memcpy(&count, bytes + 8, sizeof(count));
+      if (memcmp(bytes, MAGIC, 8) != 0 || 16 + count * sizeof(uint64_t) > static_cast<uint64_t>(info.st_size)){
+        munmap(mapping, info.st_size);
+        return false;
+      }
+      this->mapping = mapping;
+      this->mappingSize = info.st_size;
+      this->entries = reinterpret_cast<const uint64_t*>(bytes + 16);
+      this->count = count;
+      return true;
+    }
+
+    void close(){
+      if (this->mapping != nullptr){
+        munmap(this->mapping, this->mappingSize);
+      }
+      this->mapping = nullptr;
+      this->entries = nullptr;
+      this->count = 0;
+    }
+
+    uint64_t size() const {
+      return this->count;
+    }
+
+    // Returns the best column for position (and its score), -1 if position isn't in the book
+    int lookup(const BitboardPosition& position, int& score) const {
+      bool mirrored;
+      uint64_t key = position.canonicalKey(mirrored);
+      const uint64_t* end = this->entries + this->count;
+      const uint64_t* found = lower_bound(this->entries, end, key << 10);
+      if (found == end || (*found >> 10) != key){
+        return -1;
+      }
+      score = static_cast<int>((*found >> 3) & 0x7F) - 32;
+      int col = *found & 7;
+      return mirrored ? BitboardPosition::WIDTH - 1 - col : col;
+    }
+
+    static uint64_t makeEntry(uint64_t canonicalKey, int score, int col){
+      return canonicalKey << 10 | static_cast<uint64_t>(score + 32) << 3 | col;
+    }
+
+    // Solves every position up to depth moves after root (the game still going, mirror images once), returns sorted entries
+    static vector<uint64_t> build(const BitboardPosition& root, int depth, int tableSizeMB, bool weak, int threads = 1, const string& checkpointPath = "", ostream* progress = nullptr){
       /*
-      1. For the number of times specified, randomly select a number 0-6
-      2. Created a new state based on that move (if possible)
-      3. Check that state for w/l/d (by calling getGameState)
-      4. Update root node's (and children) ni, and wi, li, di as necessary
-      5. Check if the Node has been fully mapped yet (TODO: compare against .txt file)
-      5. If current node is a final state, it has been fully mapped. TODO: Write to .txt file
-      6. Go up a level until in the tree until a Node is found that hasn't been fully mapped. Else, repeat process
+      Positions are solved on a WorkStealingPool, deepest first (their bounds in the shared SolverTable help with the
+      positions above them), in tasks of positionsPerTask. Each finished task's entries are appended to the checkpoint file
+      (if given); a build started with the same root and depth skips every position found there, and the checkpoint is
+      removed once the build is complete.
       */
+      const int positionsPerTask = 16;
+      vector<BitboardPosition> positions = enumerate(root, depth);
+      reverse(positions.begin(), positions.end());
 
-      unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();   // Use the current time to seed the psuedo-random number generator
-      subtract_with_carry_engine<unsigned,24,10,24> generator (seed);
+      vector<uint64_t> entries;
+      unordered_set<uint64_t> done;
+      ofstream checkpoint;
+      if (!checkpointPath.empty()){
+        entries = readCheckpoint(checkpointPath, root.key(), depth);
+        for (uint64_t entry : entries){
+          done.insert(entry >> 10);
+        }
+        if (progress != nullptr && !entries.empty()){
+          *progress << "Resuming with " << entries.size() << " positions from " << checkpointPath << endl;
+        }
+        rewriteCheckpoint(checkpointPath, root.key(), depth, entries);
+        checkpoint.open(checkpointPath, ios::binary | ios::app);
+      }
+      vector<BitboardPosition> remaining;
+      for (const BitboardPosition& position : positions){
+        bool mirrored;
+        if (done.count(position.canonicalKey(mirrored)) == 0){
+          remaining.push_back(position);
+        }
+      }
 
-      int currentPlayer;
-      if (playerJustMoved == -1){
-        currentPlayer = 1;
+      SolverTable table(tableSizeMB);   // Shared by all positions, they have many successors in common
+      WorkStealingPool pool(max(threads, 1));
+      TaskGroup group;
+      mutex resultsLock;
+      long long solved = entries.size();
+      for (size_t first = 0; first < remaining.size(); first += positionsPerTask){
+        pool.submit(group, [&, first](){
+          Solver solver(&table);
+          vector<uint64_t> solvedEntries;
+          for (size_t i = first; i < min(first + positionsPerTask, remaining.size()); i++){
+            solvedEntries.push_back(solveEntry(remaining[i], solver, weak));
+          }
+          lock_guard<mutex> guard(resultsLock);
+          entries.insert(entries.end(), solvedEntries.begin(), solvedEntries.end());
+          if (checkpoint.is_open()){
+            checkpoint.write(reinterpret_cast<const char*>(solvedEntries.data()), solvedEntries.size() * sizeof(uint64_t));
+            checkpoint.flush();
+          }
+          long long before = solved;
+          solved += solvedEntries.size();
+          if (progress != nullptr && before / 1000 != solved / 1000){
+            *progress << "Solved " << solved << " of " << positions.size() << " positions" << endl;
+          }
+        });
       }
-      else {
-          currentPlayer = 3 - this->playerJustMoved;   // Get the number of the player currently playing
+      pool.wait(group);
+
+      if (checkpoint.is_open()){
+        checkpoint.close();
+        remove(checkpointPath.c_str());
+      }
+      sort(entries.begin(), entries.end());
+      return entries;
+    }
+
+    // Every position up to depth moves after root that isn't over, one per mirror pair (canonical orientation)
+    static vector<BitboardPosition> enumerate(const BitboardPosition& root, int depth){
+      vector<BitboardPosition> positions;
+      unordered_set<uint64_t> seen;
+      vector<BitboardPosition> layer = {root};
+      for (int ply = 0; ply <= depth && !layer.empty(); ply++){
+        vector<BitboardPosition> next;
+        for (const BitboardPosition& position : layer){
+          bool mirrored;
+          if (!seen.insert(position.canonicalKey(mirrored)).second){
+            continue;
+          }
+          positions.push_back(position);
+          for (int col = 0; col < BitboardPosition::WIDTH && ply < depth; col++){
+            if (position.canPlay(col) && !position.isWinningMove(col) && position.moves + 1 < BitboardPosition::WIDTH * BitboardPosition::HEIGHT){
+              BitboardPosition child = position;
+              child.play(col);
+              next.push_back(child);
+            }
+          }
+        }
+        layer.swap(next);
+      }
+      return positions;
+    }
+
+    // Book entry for one position: the best column (center first among equals) and its score
+    static uint64_t solveEntry(const BitboardPosition& position, Solver& solver, bool weak){
+      array<int, 7> scores = solver.analyze(position, weak);
+      int best = -1;
+      for (int col : {3, 2, 4, 1, 5, 0, 6}){
+        if (scores[col] != Solver::INVALID_MOVE && (best == -1 || scores[col] > scores[best])){
+          best = col;
+        }
+      }
+      bool mirrored;
+      uint64_t key = position.canonicalKey(mirrored);
+      return makeEntry(key, scores[best], mirrored ? BitboardPosition::WIDTH - 1 - best : best);
+    }
+
+    // Writes sorted entries in the format open() reads
+    static bool write(const string& path, const vector<uint64_t>& entries){
+      ofstream output(path, ios::binary);
+      uint64_t count = entries.size();
+      output.write(MAGIC, 8);
+      output.write(reinterpret_cast<const char*>(&count), sizeof(count));
+      output.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(uint64_t));
+      return static_cast<bool>(output);
+    }
+
+  private:
+    static constexpr const char* MAGIC = "C4BOOK01";
+    static constexpr const char* CHECKPOINT_MAGIC = "C4CKPT01";
+
+    // Entries saved by an earlier build of the same book (checkpoint: magic, root key, depth, then entries in any order)
+    static vector<uint64_t> readCheckpoint(const string& path, uint64_t rootKey, int depth){
+      vector<uint64_t> entries;
+      ifstream input(path, ios::binary);
+      char magic[8];
+      uint64_t header[2];
+      if (!input.read(magic, 8) || memcmp(magic, CHECKPOINT_MAGIC, 8) != 0 || !input.read(reinterpret_cast<char*>(header), sizeof(header))){
+        return entries;
+      }
+      if (header[0] != rootKey || header[1] != static_cast<uint64_t>(depth)){    // Checkpoint of another book
+        return entries;
+      }
+      uint64_t entry;
+      while (input.read(reinterpret_cast<char*>(&entry), sizeof(entry))){   // A partly written last entry is dropped
+        entries.push_back(entry);
+      }
+      return entries;
+    }
+
+    static void rewriteCheckpoint(const string& path, uint64_t rootKey, int depth, const vector<uint64_t>& entries){
+      ofstream output(path, ios::binary | ios::trunc);
+      uint64_t header[2] = {rootKey, static_cast<uint64_t>(depth)};
+      output.write(CHECKPOINT_MAGIC, 8);
+      output.write(reinterpret_cast<const char*>(header), sizeof(header));
+      output.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(uint64_t));
+    }
+
+    const uint64_t* entries;
+    uint64_t count;
+    void* mapping;
+    size_t mappingSize;
+};
+
+// Memory mapping of a whole file (read only, or created with a given size for writing), unmapped when destroyed
+class MappedFile {
+  public:
+    char* data;
+    size_t size;
+
+    MappedFile(){
+      this->data = nullptr;
+      this->size = 0;
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile(){
+      this->close();
+    }
+
+    // Maps an existing file for reading, returns false if it can't be read
+    bool open(const string& path){
+      this->close();
+      int fd = ::open(path.c_str(), O_RDONLY);
+      if (fd < 0){
+        return false;
+      }
+      struct stat info;
+      bool mapped = fstat(fd, &info) == 0 && this->map(fd, info.st_size, PROT_READ);
+      ::close(fd);
+      return mapped;
+    }
+
+    // Creates (or truncates) the file with size bytes and maps it for writing
+    bool create(const string& path, size_t size){
+      this->close();
+      int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+      if (fd < 0){
+        return false;
+      }
+      bool mapped = ftruncate(fd, size) == 0 && this->map(fd, size, PROT_READ | PROT_WRITE);
+      ::close(fd);
+      return mapped;
+    }
+
+    void close(){
+      if (this->data != nullptr){
+        munmap(this->data, this->size);
+      }
+      this->data = nullptr;
+      this->size = 0;
+    }
+
+  private:
+    bool map(int fd, size_t size, int protection){
+      this->size = size;
+      if (size == 0){   // mmap() can't map an empty file, data stays nullptr
+        return true;
+      }
+      void* mapping = mmap(nullptr, size, protection, MAP_SHARED, fd, 0);
+      if (mapping == MAP_FAILED){
+        this->size = 0;
+        return false;
+      }
+      this->data = static_cast<char*>(mapping);
+      return true;
+    }
+};
+
+// Win, draw or loss of every position below a root position with at most a given number of empty cells, read from a
+// file built by Tablebase::build()
+class Tablebase {
+  /*
+  File: "C4TBASE3", the root's key, the first stored number of stones, the number of layers (one per number of stones,
+  up to 41), then the size and offset of each layer. A layer is 2 bits (LOSS, DRAW or WIN for the player to move, or
+  UNKNOWN) for each PositionRanking rank below the root, so no keys are stored. Positions that can't be reached from
+  the root, or where the game is over, are UNKNOWN, which is 0 so that the unreached parts of a layer stay sparse.
+  */
+  public:
+    static const int UNKNOWN = 0;
+    static const int LOSS = 1;
+    static const int DRAW = 2;
+    static const int WIN = 3;
+
+    Tablebase(){
+      this->first = 0;
+      this->layers = 0;
+    }
+
+    // Maps the tablebase file, returns false if it can't be read or isn't a tablebase
+    bool open(const string& path){
+      this->close();
+      if (!this->file.open(path) || this->file.size < 32 || memcmp(this->file.data, MAGIC, 8) != 0){
+        this->file.close();
+        return false;
+      }
+      const uint64_t* header = reinterpret_cast<const uint64_t*>(this->file.data);
+      uint64_t layers = header[3];
+      BitboardPosition root = BitboardPosition::fromKey(header[1]);
+      PositionRanking ranking(root);
+      if (layers > 42 || 32 + layers * 16 > this->file.size || header[2] < static_cast<uint64_t>(root.moves)){
+        this->file.close();
+        return false;
+      }
+      for (uint64_t k = 0; k < layers; k++){
+        const uint64_t* layer = header + 4 + 2 * k;
+        if (layer[0] != ranking.size(header[2] + k - root.moves) || layer[1] + (layer[0] + 3) / 4 > this->file.size){
+          this->file.close();
+          return false;
+        }
+        this->values[k] = reinterpret_cast<const uint8_t*>(this->file.data + layer[1]);
+        this->counts[k] = layer[0];
+      }
+      this->ranking = ranking;
+      this->first = header[2];
+      this->layers = layers;
+      return true;
+    }
+
+    void close(){
+      this->file.close();
+      this->layers = 0;
+    }
+
+    // Does the tablebase have positions with this many stones?
+    bool covers(int stones) const {
+      return stones >= this->first && stones < this->first + this->layers;
+    }
+
+    // Number of positions with a value (a pass over the whole file)
+    uint64_t size() const {
+      uint64_t total = 0;
+      for (int k = 0; k < this->layers; k++){
+        for (uint64_t rank = 0; rank < this->counts[k]; rank++){
+          total += getValue(this->values[k], rank) != UNKNOWN;
+        }
+      }
+      return total;
+    }
+
+    // Sets value to 1, 0 or -1 (win, draw or loss for the player to move), returns false if position isn't stored
+    bool probe(const BitboardPosition& position, int& value) const {
+      if (!this->covers(position.moves) || !this->ranking.extends(position)){
+        return false;
+      }
+      int code = getValue(this->values[position.moves - this->first], this->ranking.rank(position));
+      if (code == UNKNOWN){
+        return false;
+      }
+      value = code - DRAW;
+      return true;
+    }
+
+    // Returns a move keeping position's value (center first among equals) and sets value, -1 if position isn't stored
+    int bestMove(const BitboardPosition& position, int& value) const {
+      int best = -1;
+      for (int col : {3, 2, 4, 1, 5, 0, 6}){
+        if (!position.canPlay(col)){
+          continue;
+        }
+        int childValue = 0;   // For the player who moves after col
+        if (position.isWinningMove(col)){
+          value = 1;
+          return col;
+        }
+        BitboardPosition child = position;
+        child.play(col);
+        if (child.moves < BitboardPosition::WIDTH * BitboardPosition::HEIGHT && !this->probe(child, childValue)){
+          return -1;
+        }
+        if (best == -1 || -childValue > value){
+          best = col;
+          value = -childValue;
+        }
+      }
+      return best;
+    }
+
+    // Builds the tablebase of every position with at most maxEmpty empty cells reachable from root into path
+    static bool build(const BitboardPosition& root, int maxEmpty, const string& path, size_t ranksPerRun = 1 << 22, ostream* progress = nullptr){
+      /*
+      Every layer is a 2 bit array over the PositionRanking ranks below root: the stored layers in the mapped output
+      file, the layers above them in mapped scratch files (deleted once the next layer is marked). The files start out
+      as holes of zeros, which are UNKNOWN.
+      1. Forward: the ranks of the children of each reached position (not after a winning move) are collected ranksPerRun
+         at a time, sorted and marked as reached in the next layer in rank order, so the writes sweep through it.
+      2. Backward: from the last layer up, each reached position is labelled from its children's values in the layer below.
+      Both passes stream through one layer. The backward pass reads its children at random ranks in the layer below, so
+      it is fastest when that layer fits in memory.
+      */
+      const int cells = BitboardPosition::WIDTH * BitboardPosition::HEIGHT;
+      int first = max(root.moves, cells - maxEmpty);
+      if (first >= cells){
+        return false;
+      }
+      PositionRanking ranking(root);
+      int layers = cells - first;
+      vector<uint64_t> header = {0, root.key(), static_cast<uint64_t>(first), static_cast<uint64_t>(layers)};
+      memcpy(&header[0], MAGIC, 8);
+      uint64_t offset = (4 + 2 * layers) * sizeof(uint64_t);
+      for (int stones = first; stones < cells; stones++){
+        uint64_t count = ranking.size(stones - root.moves);
+        header.push_back(count);
+        header.push_back(offset);
+        offset += (count + 3) / 4;
+      }
+      MappedFile output;
+      if (!output.create(path, offset)){
+        return false;
+      }
+      memcpy(output.data, header.data(), header.size() * sizeof(uint64_t));
+
+      vector<unique_ptr<MappedFile>> scratch;
+      auto layer = [&](int stones){
+        if (stones >= first){
+          return reinterpret_cast<uint8_t*>(output.data + header[4 + 2 * (stones - first) + 1]);
+        }
+        return reinterpret_cast<uint8_t*>(scratch[stones - root.moves]->data);
+      };
+      for (int stones = root.moves; stones < first; stones++){
+        size_t bytes = (ranking.size(stones - root.moves) + 3) / 4;
+        scratch.emplace_back(new MappedFile());
+        if (!scratch.back()->create(scratchPath(path, stones), bytes)){
+          return false;
+        }
+      }
+
+      vector<uint64_t> children;
+      children.reserve(ranksPerRun + BitboardPosition::WIDTH);
+      auto markChildren = [&](uint8_t* next){
+        sort(children.begin(), children.end());
+        for (uint64_t rank : children){
+          setValue(next, rank, DRAW);
+        }
+        children.clear();
+      };
+
+      setValue(layer(root.moves), ranking.rank(root), DRAW);   // Any value but UNKNOWN marks a reached position
+      for (int stones = root.moves; stones + 1 < cells; stones++){
+        uint8_t* values = layer(stones);
+        uint8_t* next = layer(stones + 1);
+        uint64_t count = ranking.size(stones - root.moves);
+        uint64_t reached = 0;
+        for (uint64_t rank = 0; rank < count; rank++){
+          if (values[rank >> 2] == 0){   // Skips 4 unreached positions at once
+            rank |= 3;
+            continue;
+          }
+          if (getValue(values, rank) == UNKNOWN){
+            continue;
+          }
+          reached ++;
+          BitboardPosition position = ranking.unrank(stones - root.moves, rank);
+          for (int col = 0; col < BitboardPosition::WIDTH; col++){
+            if (position.canPlay(col) && !position.isWinningMove(col)){
+              BitboardPosition child = position;
+              child.play(col);
+              children.push_back(ranking.rank(child));
+            }
+          }
+          if (children.size() >= ranksPerRun){
+            markChildren(next);
+          }
+        }
+        markChildren(next);
+        if (progress != nullptr){
+          *progress << "Layer " << stones << ": " << reached << " positions of " << count << " ranks" << endl;
+        }
+        if (stones < first){
+          scratch[stones - root.moves]->close();
+          remove(scratchPath(path, stones).c_str());
+        }
+      }
+
+      for (int stones = cells - 1; stones >= first; stones--){
+        uint8_t* values = layer(stones);
+        const uint8_t* next = (stones + 1 < cells) ? layer(stones + 1) : nullptr;
+        uint64_t count = ranking.size(stones - root.moves);
+        for (uint64_t rank = 0; rank < count; rank++){
+          if (getValue(values, rank) != UNKNOWN){
+            setValue(values, rank, label(ranking.unrank(stones - root.moves, rank), ranking, next));
+          }
+        }
+        if (progress != nullptr){
+          *progress << "Labelled layer " << stones << endl;
+        }
+      }
+      return true;
+    }
+
+  private:
+    static constexpr const char* MAGIC = "C4TBASE3";
+
+    static string scratchPath(const string& path, int stones){
+      return path + ".reached" + to_string(stones);
+    }
+
+    static int getValue(const uint8_t* values, uint64_t rank){
+      return (values[rank >> 2] >> (2 * (rank & 3))) & 3;
+    }
+
+    static void setValue(uint8_t* values, uint64_t rank, int code){
+      int shift = 2 * (rank & 3);
+      values[rank >> 2] = (values[rank >> 2] & ~(3 << shift)) | (code << shift);
+    }
+
+    // Value of a reached position from the values of the layer below (next)
+    static int label(const BitboardPosition& position, const PositionRanking& ranking, const uint8_t* next){
+      if (position.canWinNext()){
+        return WIN;
+      }
+      if (position.moves + 1 == BitboardPosition::WIDTH * BitboardPosition::HEIGHT){    // The last stone fills the board
+        return DRAW;
+      }
+      int code = LOSS;
+      uint64_t moves = position.possibleNonLosingMoves();   // Every other move lets the opponent win
+      for (int col = 0; col < BitboardPosition::WIDTH && code != WIN; col++){
+        uint64_t move = moves & BitboardPosition::columnMask(col);
+        if (move != 0){
+          BitboardPosition child = position;
+          child.playMove(move);
+          code = max(code, WIN + LOSS - getValue(next, ranking.rank(child)));    // The opponent's loss is a win
+        }
+      }
+      return code;
+    }
+
+    MappedFile file;
+    PositionRanking ranking;
+    int first;                  // Stones in the first layer
+    int layers;
+    uint64_t counts[42];
+    const uint8_t* values[42];
+};
+
+// Define some class data structures
+class c4Board {
+    /*
+    0 |  -1  -1  -1  -1  -1  -1  -1
+    1 |  -1  -1  -1  -1  -1  -1  -1
+    2 |  -1  -1  -1  -1  -1  -1  -1
+    3 |  -1  -1  -1  -1  -1  -1  -1
+    4 |  -1  -1  -1  -1  -1  -1  -1
+    5 |  -1  -1  -1  -1  -1  -1  -1
+    --|----------------------------
+      |   0   1   2   3   4   5   6
+    */
+  public:
+    array<array<int, 7>, 6> tileSpaces;   // [rows][columns] -> [0-5][0-6]
+
+    c4Board *previousMove;    // Dereference pointer to previous node
+    c4Board *nextMove;        // Dereference pointer to next node
+
+    int playerJustMoved;    // The player who just played (1 is Red Player & 2 is Yellow) TODO: change this to currentPlayer
+    bool endOfGame;         // Is true if no more moves are possible or necessary
+    int winningPlayer;      // The player number of the player that won
+
+    // Default Class Constructor (Only called initially)
+    c4Board(){
+      for (int i = 0; i < 6; i++) {     // For each row
+        for (int j = 0; j < 7; j++) {    // For each column
+          this->tileSpaces[i][j] = -1;      // write as default value
+        }
+      }
+
+      // Initialize to default values
+      this->previousMove = nullptr;
+      this->nextMove = nullptr;
+      this->playerJustMoved = -1;
+      this->endOfGame = false;        // Default to false, only changed by gameOver()
+      this->winningPlayer = -1;
+    }
+
+    // Class Constructor for creating a next Node (with link to previous)
+    c4Board(c4Board* previousBoard, int playerNum){    // pointer to previous board, number of current player
+      this->tileSpaces = previousBoard->tileSpaces;  // Copy
+
+      this->previousMove = previousBoard;   // link previousMove to the given pointer
+      this->nextMove = nullptr;             // Dereference the class pointer for next node
+      previousBoard->nextMove = this;      // link nextMove of previousBoard to this
+
+      this->playerJustMoved = playerNum;    // playerNum is the current player (of previous board), stored to playerJustMoved
+      this->endOfGame = false;              // Default to false, only changed by gameOver()
+      this->winningPlayer = -1;             // Will remain negative one until either Red or Yellow wins (does not change for Draw)
+    }
+
+    // Class Copy Constrcutor for creating a new instance from a given instance
+    c4Board (const c4Board &givenBoard) {
+      this->tileSpaces = givenBoard.tileSpaces;
+
+      this->previousMove = givenBoard.previousMove;
+      this->nextMove = givenBoard.nextMove;
+
+      this->playerJustMoved = givenBoard.playerJustMoved;
+      this->endOfGame = givenBoard.endOfGame;
+      this->winningPlayer = givenBoard.winningPlayer;
+    }
+
+    friend ostream &operator<<(ostream &output, const c4Board& obj) {
+      string rows = "012345";
+      string columns = "0123456";
+      for (int i = 0; i < obj.tileSpaces.size(); i++) {        // For each row
+        output << rows[i] << " |";
+        for (int j = 0; j < obj.tileSpaces[i].size(); j++) {   // For each column
+          if (obj.tileSpaces[i][j] == -1) {
+            output << setw(4) << ".";
+          }
+          else if (obj.tileSpaces[i][j] == 1) {
+            output << setw(4) << "R";
+          }
+          else if (obj.tileSpaces[i][j] == 2) {
+            output << setw(4) << "Y";
+          }
+        }
+        output << endl;
+      }
+      output << "--|----------------------------" << endl << "  |";
+      for (int i = 0; i < columns.length(); i++){
+        output << setw(4) << columns[i];
+      }
+      output << endl;
+      return output;
+    }
+
+    // TODO: does c4Board need this or just Node?
+    friend bool operator==(const c4Board& lhs, const c4Board& rhs) {       // p1.operator==(p2)
+      return lhs.tileSpaces == rhs.tileSpaces;
+    }
+
+    c4Board dropToken(int colNum) {
+      /*
+      Returns a new instance of c4Board with the latest player's move and a pointer make to the previous state
+      Only allows legal moves (column selection and tokens in a column)
+      */
+      bool validMove = false;     // Changes if a valid move is found
+      int currentPlayer;
+      if (playerJustMoved == -1){
+        currentPlayer = 1;
+      }
+      else {
+          currentPlayer = 3 - this->playerJustMoved;   // Get the number of the player currently playing
+      }
+
+      c4Board tmp(this, currentPlayer);   // Create a new board with a pointer back to the current state and the currentPlayer
+
+      // Iterate through tileSpaces[i][colNum] backwards until tileSpaces[i][i] == -1, then tileSpaces[rowNum][colNum] = currentPlayer
+      for (int i = 5; i >= 0; i--) {   // Starting at the bottom of the row and working to the top
+        //cout << i << ", " << colNum << ": " << tmp.tileSpaces[i][colNum] << endl;   // For test purposes
+        if (tmp.tileSpaces[i][colNum] == -1) {   // If the current tile has no token yet
+          tmp.tileSpaces[i][colNum] = currentPlayer;
+          validMove = true;
+          break;
+        }
+      }
+      if (!validMove) {
+        cout << "This column is already full. Choose a different move" << endl;
+        return *this;   // Return the same instance the function was called from
+      }
+
+      return tmp;
+    }
+
+    bool continuePlaying() {
+      /* Returns "false" to terminate game if winning move is detected, otherwise returns "true" if available moves are left */
+
+      // If there are four vertical matching tokens
+      for (int i = 0; i + 3 < this->tileSpaces.size(); i++) {     // For each row
+        for (int j = 0; j < this->tileSpaces[i].size(); j++) {      // For each column
+          // cout << "i: " << i << ", j: " << j << endl;  // For test purposes
+          // cout << this->tileSpaces[i][j] << " " << this->tileSpaces[i + 1][j] << " " << this->tileSpaces[i + 2][j] << " " << this->tileSpaces[i + 3][j] << endl;
+          if (this->tileSpaces[i][j] != -1 && this->tileSpaces[i][j] == this->tileSpaces[i + 1][j] && this->tileSpaces[i][j] == this->tileSpaces[i + 2][j] && this->tileSpaces[i][j] == this->tileSpaces[i + 3][j]){
+            this->winningPlayer = this->tileSpaces[i][j];
+            return false;
+          }
+        }
+      }
+
+      // If there are four horizontal matching tokens
+      for (int i = 0; i < this->tileSpaces.size(); i++) {     // For each row
+        for (int j = 0; j + 3 < this->tileSpaces[i].size(); j++) {      // For each column
+          // cout << "i: " << i << ", j: " << j << endl;  // For test purposes
+          // cout << this->tileSpaces[i][j] << " " << this->tileSpaces[i][j + 1] << " " << this->tileSpaces[i][j + 2] << " " << this->tileSpaces[i][j + 3] << endl;
+          if (this->tileSpaces[i][j] != -1 && this->tileSpaces[i][j] == this->tileSpaces[i][j + 1] && this->tileSpaces[i][j] == this->tileSpaces[i][j + 2] && this->tileSpaces[i][j] == this->tileSpaces[i][j + 3]){
+            this->winningPlayer = this->tileSpaces[i][j];
+            return false;
+          }
+        }
+      }
+
+      // If there are four diagonal matching tokens L->R descending
+      for (int i = 0; i + 3 < this->tileSpaces.size(); i++) {     // For each row
+        for (int j = 0; j + 3 < this->tileSpaces[i].size(); j++) {      // For each column
+          // cout << "i: " << i << ", j: " << j << endl;  // For test purposes
+          if (this->tileSpaces[i][j] != -1 && this->tileSpaces[i][j] == this->tileSpaces[i + 1][j + 1] && this->tileSpaces[i][j] == this->tileSpaces[i + 2][j + 2] && this->tileSpaces[i][j] == this->tileSpaces[i + 3][j + 3]){
+            this->winningPlayer = this->tileSpaces[i][j];
+            return false;
+          }
+        }
+      }
+
+      // If there are four diagonal matching tokens R->L descending
+      for (int i = 0; i + 3 < this->tileSpaces.size(); i++) {     // For each row
+        for (int j = tileSpaces[i].size() - 1; j >= 3; j--) {      // For each column
+          // cout << "i: " << i << ", j: " << j << endl;  // For test purposes
+          // cout << this->tileSpaces[i][j] << " " << this->tileSpaces[i + 1][j - 1] << " " << this->tileSpaces[i + 2][j - 2] << " " << this->tileSpaces[i + 3][j - 3] << endl;
+          if (this->tileSpaces[i][j] != -1 && this->tileSpaces[i][j] == this->tileSpaces[i + 1][j - 1] && this->tileSpaces[i][j] == this->tileSpaces[i + 2][j - 2] && this->tileSpaces[i][j] == this->tileSpaces[i + 3][j - 3]){
+            this->winningPlayer = this->tileSpaces[i][j];
+            return false;
+          }
+        }
+      }
+
+      // If any empty spaces remain in the board
+      for (int i = 0; i < this->tileSpaces.size(); i++) {        // For each row
+        for (int j = 0; j < this->tileSpaces[i].size(); j++) {   // For each column
+          if (this->tileSpaces[i][j] == -1){  // This will only execute if there are valid moves left to make
+            return true;
+          }
+        }
+      }
+
+      // If none of the above returns are triggered
+      return false;
+    }
+  };
+
+class Node {
+  /*
+  Some member functions:
+  makeMove()- chooses the best move to make by creating a test node (keeps track of the results for each possible move)
+  X isPossible()- returns true if a token can be dropped in a given column
+  X getChildren()- creates a new node based on a token dropped in the given column
+  X getGameState()- returns -1 for a game in progress, 1 is player 1 has won, 2 if player 2 has won, and 3 if the game is a draw
+  sampleNodePath()- randomly makes moves, checking each new node for final state by calling getGameState()
+  movesLeft()- Returns the number of empty spaces still available on the board (used to calculate how many child nodes there should be)
+  */
+  public:
+    int ni;   // Accumulator for number of nodes sampled (only count final gameStates)
+    int wi;   // Accumulator for number of nodes that are wins (wi/ni is likelihood of winning)
+    int di;   // Accumulator for number of nodes that are draws
+
+    // Store a copy of the current game state
+    array<array<int, 7>, 6> tileSpaces;   // [rows][columns]
+    int playerJustMoved;      // The player who just played (1 is Red Player & 2 is Yellow)
+    int winningPlayer;        // The player number of the player that won
+    unsigned long long hashKey;   // Zobrist hash of tileSpaces (updated incrementally by getChildNode())
+
+    // Pointers for previous state and each possble next state
+    Node *previousBoard;     // Should be nullptr when initially constructed (root is always the move under consideration)
+    Node *nextMove1;
+    Node *nextMove2;
+    Node *nextMove3;
+
+    // Default constructor
+    Node() {
+      // Fill board with placeholder values
+      for (int i = 0; i < this->tileSpaces.size(); i++){
+        for (int j = 0; j < this->tileSpaces[i].size(); j++){
+          this->tileSpaces[i][j] = -1;
+        }
+      }
+
+      // Initialize accumulators tp initial value (0)
+      this->ni = 0;
+      this->wi = 0;
+      this->di = 0;
+
+      // Set to placeholder values
+      this->playerJustMoved = -1;
+      this->winningPlayer = -1;
+      this->hashKey = emptyBoardHash;
+
+      // Set pointers to null value
+      this->previousBoard = nullptr;
+      this->nextMove1 = nullptr;
+      this->nextMove2 = nullptr;
+      this->nextMove3 = nullptr;
+    }
+
+    // Constructor called when an instance of Node is created from an instance of c4Board
+    Node(c4Board currentBoard) {
+      // Initialize accumulators to initial value (0)
+      this->ni = 0;
+      this->wi = 0;
+      this->di = 0;
+
+      // Copy data from currentBoard
+      this->tileSpaces = currentBoard.tileSpaces;
+      this->playerJustMoved = currentBoard.playerJustMoved;  // MCTS finds best possible move against this player
+      this->winningPlayer = currentBoard.winningPlayer;      // Should be -1
+      this->hashKey = positionHash(this->tileSpaces);
+
+      // Node being constructed is root, so previousBoard = nullptr
+      this->previousBoard = nullptr;
+
+      // Initialize to default values
+      this->nextMove1 = nullptr;
+      this->nextMove2 = nullptr;
+      this->nextMove3 = nullptr;
+    }
+
+    // Constructor for creating children nodes
+    Node(Node* currentBoard, int playerNum) {
+      // Initialize accumulators to initial value (0)
+      this->ni = 0;
+      this->wi = 0;
+      this->di = 0;
+
+      // Copy data from currentBoard
+      this->tileSpaces = currentBoard->tileSpaces;
+      this->playerJustMoved = playerNum;
+      this->winningPlayer = currentBoard->winningPlayer;      // Should be -1
+      this->hashKey = currentBoard->hashKey;     // Updated by getChildNode() once the token is placed
+
+      // Link to Node of previous game board
+      this->previousBoard = currentBoard;
+
+      // Initialize to default values
+      this->nextMove1 = nullptr;
+      this->nextMove2 = nullptr;
+      this->nextMove3 = nullptr;
+    }
+
+    // Plays the columns in moves (e.g. "3342", the format written by --selfplay), returns false if a move is illegal or the game was already over
+    bool playMoves(const string& moves){
+      for (char move : moves){
+        int col = move - '0';
+        if (col < 0 || col > 6 || !this->isPossible(col) || this->getGameState() != -1){
+          return false;
+        }
+        Node previous = *this;
+        *this = previous.getChildNode(col);
+      }
+      return true;
+    }
+
+    friend ostream &operator<<(ostream &output, const Node& obj){
+      string rows = "012345";
+      string columns = "0123456";
+      for (int i = 0; i < obj.tileSpaces.size(); i++) {        // For each row
+        output << rows[i] << " |";
+        for (int j = 0; j < obj.tileSpaces[i].size(); j++) {   // For each column
+          if (obj.tileSpaces[i][j] == -1) {
+            output << setw(4) << ".";
+          }
+          else if (obj.tileSpaces[i][j] == 1) {
+            output << setw(4) << "R";
+          }
+          else if (obj.tileSpaces[i][j] == 2) {
+            output << setw(4) << "Y";
+          }
+        }
+        output << endl;
+      }
+      output << "--|----------------------------" << endl << "  |";
+      for (int i = 0; i < columns.length(); i++){
+        output << setw(4) << columns[i];
+      }
+      output << endl;
+      return output;
+    }
+
+    bool operator==(const Node& rhs) {        // p1.operator==(p2)
+      return this->tileSpaces == rhs.tileSpaces;
+    }
+
+    bool operator!=(const Node& rhs) {
+      return not (this == &rhs);
+    }
+
+    Node& operator= (const Node& rhs) {       // p1 = p2
+      this->ni = rhs.ni;
+      this->wi = rhs.wi;
+      this->di = rhs.di;
+
+      // Copy data from currentBoard
+      this->tileSpaces = rhs.tileSpaces;
+      this->playerJustMoved = rhs.playerJustMoved;
+      this->winningPlayer = rhs.winningPlayer;      // Should be -1
+      this->hashKey = rhs.hashKey;
+
+      // Link to Node of previous game board
+      this->previousBoard = rhs.previousBoard;
+
+      return *this;
+    }
+
+    // Creates a node that is the result of a move made in currentNode (provides linking)
+    Node getChildNode(int colNum) {
+      /*
+      Returns a Node with the most recent move (and a pointer to previous boards)
+      */
+      int currentPlayer;
+      if (playerJustMoved == -1){
+        currentPlayer = 1;
+      }
+      else {
+          currentPlayer = 3 - this->playerJustMoved;   // Get the number of the player currently playing
+      }
+
+      Node child(this, currentPlayer);   // Create a new board with a pointer back to the current state and the currentPlayer
+
+      // Figure out which child is being created
+      if (this->nextMove1 == nullptr){
+        this->nextMove1 = &child;
+      }
+      else if (this->nextMove2 == nullptr){
+        this->nextMove2 = &child;
+      }
+      else if (this->nextMove3 == nullptr){
+        this->nextMove3 = &child;
+      }
+
+      // Iterate through tileSpaces[i][colNum] backwards until tileSpaces[i][i] == -1, then tileSpaces[rowNum][colNum] = currentPlayer
+      for (int i = 5; i >= 0; i--) {   // Starting at the bottom of the row and working to the top
+        if (child.tileSpaces[i][colNum] == -1) {   // If the current tile has no token yet
+          child.tileSpaces[i][colNum] = currentPlayer;
+          child.hashKey ^= zobristKey(i, colNum, currentPlayer);
+          break;  // Break out of loop when move has been made
+        }
+      }
+      //cout << child;  // For test purposes
+      return child;
+    }
+
+    // Checks the validity of making a move in a given column
+    bool isPossible(int colNum){    // currentBoard.isPossible(int)
+      /*
+      Returns True the specified column still has empty spaces, returns False if it is full
+      */
+      for (int i = 0; i < this->tileSpaces.size(); i++){      // For each row
+        if (this->tileSpaces[i][colNum] == -1){   // Executes as soon as an available move is found
+          return true;
+        }
+      }
+
+      return false;
+    }
+
+    // Returns a number indicating state of game (win/lose/draw/in play)
+    int getGameState(){    // currentBoard.getGameState()
+      /*
+      Possible Return Values:
+      -1: game in progress, no winner yet
+      1: Red has won!
+      2: Yellow has won!
+      3: Game is a draw.
+      */
+
+      // If there are four vertical tokens
+      for (int i = 0; i + 3 < this->tileSpaces.size(); i++) {     // For each row
+        for (int j = 0; j < this->tileSpaces[i].size(); j++) {      // For each column
+          if (this->tileSpaces[i][j] != -1 && this->tileSpaces[i][j] == this->tileSpaces[i + 1][j] && this->tileSpaces[i][j] == this->tileSpaces[i + 2][j] && this->tileSpaces[i][j] == this->tileSpaces[i + 3][j]){
+            return this->tileSpaces[i][j];
+          }
+        }
+      }
+
+      // If there are four horizontal tokens
+      for (int i = 0; i < this->tileSpaces.size(); i++) {     // For each row
+        for (int j = 0; j + 3 < this->tileSpaces[i].size(); j++) {      // For each column
+          if (this->tileSpaces[i][j] != -1 && this->tileSpaces[i][j] == this->tileSpaces[i][j + 1] && this->tileSpaces[i][j] == this->tileSpaces[i][j + 2] && this->tileSpaces[i][j] == this->tileSpaces[i][j + 3]){
+            return this->tileSpaces[i][j];
+          }
+        }
+      }
+
+      // If there are four diagonal tokens L->R descending
+      for (int i = 0; i + 3 < this->tileSpaces.size(); i++) {     // For each row
+        for (int j = 0; j + 3 < this->tileSpaces[i].size(); j++) {      // For each column
+          if (this->tileSpaces[i][j] != -1 && this->tileSpaces[i][j] == this->tileSpaces[i + 1][j + 1] && this->tileSpaces[i][j] == this->tileSpaces[i + 2][j + 2] && this->tileSpaces[i][j] == this->tileSpaces[i + 3][j + 3]){
+            return this->tileSpaces[i][j];
+          }
+        }
+      }
+
+      // If there are four diagonal tokens R->L descending
+      for (int i = 0; i + 3 < this->tileSpaces.size(); i++) {     // For each row
+        for (int j = tileSpaces[i].size() - 1; j >= 3; j--) {           // For each column
+          if (this->tileSpaces[i][j] != -1 && this->tileSpaces[i][j] == this->tileSpaces[i + 1][j - 1] && this->tileSpaces[i][j] == this->tileSpaces[i + 2][j - 2] && this->tileSpaces[i][j] == this->tileSpaces[i + 3][j - 3]){
+            return this->tileSpaces[i][j];
+          }
+        }
+      }
+
+      // If board an empty spaces remain in the board
+      for (int i = 0; i < this->tileSpaces.size(); i++) {        // For each row
+        for (int j = 0; j < this->tileSpaces[i].size(); j++) {   // For each column
+          if (this->tileSpaces[i][j] == -1){  // This will only execute if there are any valid moves left to make
+            return -1;
+          }
+        }
+      }
+
+      // If none of the above returns are triggered
+      return 3;
+    }
+
+    // Return the number of empty spaces in game board
+    int movesLeft(){
+      /*
+      If movesLeft = 0, node is fully mapped.
+      If ni = fact(movesLeft), node is fully mapped. (or some similar expression)
+      */
+      int acc = 0;    // Initialize accumulator to 0
+
+      for (int i = 0; i < this->tileSpaces.size(); i++) {   // For each row
+        for (int j = 0; j < tileSpaces[i].size(); j++) {      // For each column
+          if (tileSpaces[i][j] == -1){      // If space is empty...
+            acc ++;   // ...increment accumulator.
+          }
+        }
+      }
+      return acc;   // Return accumulator
+    }
+
+    // Returns the number of the player whose turn it is
+    int nextPlayer(){
+      if (this->playerJustMoved == -1){
+        return 1;
+      }
+      return 3 - this->playerJustMoved;
+    }
+
+    // Randomly plays one game to the end from this position, returns the final getGameState() value
+    int playout(c4Generator& generator, vector<int>* moves = nullptr, long long* nodeCount = nullptr, const Tablebase* tablebase = nullptr){    // Columns played are appended to moves and positions created are added to nodeCount (if given)
+      Node tmp = *this;   // Give tmp the same starting paramters as current instance
+      int results = tmp.getGameState();   // Store the results of the gameState check
+      bool probed = tablebase == nullptr;   // Positions below one the tablebase doesn't have aren't in it either
+      int stones = probed ? 0 : 42 - tmp.movesLeft();
+      while (results == -1){   // While the game is in progress
+        if (!probed && tablebase->covers(stones)){    // The game's result with perfect play instead of the rest of the playout
+          probed = true;
+          int value;
+          if (tablebase->probe(tmp.bitboard(), value)){
+            return (value == 0) ? 3 : (value > 0 ? tmp.nextPlayer() : 3 - tmp.nextPlayer());
+          }
+        }
+        int colNum = generator()%7;   // Choose a random number between 0-6
+        if (tmp.isPossible(colNum)){    // Check if that move is possible
+            tmp = tmp.getChildNode(colNum);   // Update tmp to be new state
+            results = tmp.getGameState();
+            stones ++;
+            if (moves != nullptr){
+              moves->push_back(colNum);
+            }
+            if (nodeCount != nullptr){
+              (*nodeCount) ++;
+            }
+        }
+      }
+      return results;
+    }
+
+    // Increments accumulators for a playout that ended with results (a getGameState() value)
+    void addResult(int results){
+      this->ni ++;    // A new possible endgame has been found
+      if (results == this->playerJustMoved) {     // The player who made this move won
+        this->wi ++;  // A winning move has been found
+      }
+      else if (results == 3) {
+        this->di ++;  // final state of this path was a draw
+      }
+    }
+
+    // Randomly play through game specified number of times, updating win, loss, or draw for the instance of Node the function is called from;
+    void sampleNodePath(int numSearches) {
+      /*
+      1. For the number of times specified, randomly select a number 0-6
+      2. Created a new state based on that move (if possible)
+      3. Check that state for w/l/d (by calling getGameState)
+      4. Update root node's (and children) ni, and wi, li, di as necessary
+      5. Check if the Node has been fully mapped yet (TODO: compare against .txt file)
+      5. If current node is a final state, it has been fully mapped. TODO: Write to .txt file
+      6. Go up a level until in the tree until a Node is found that hasn't been fully mapped. Else, repeat process
+      */
+
+      unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();   // Use the current time to seed the psuedo-random number generator
+      c4Generator generator (seed);
+
+      // Do random Playthroughs numSearches number of times
+      for (int i = 0; i < numSearches; i++){
+        this->addResult(this->playout(generator));
+      }
+      // // For test purposes
+      // cout << "Nodes searched: " << this->ni << endl;
+      // cout << "Probability of winning: " << this->wi / this->ni << endl;
+      // cout << "Number of winning Nodes: " << this->wi << endl;
+      return;
+    }
+
+    // Returns the hash of the position after dropping a token in colNum (without creating the child Node)
+    unsigned long long childHash(int colNum){
+      for (int i = 5; i >= 0; i--) {   // Starting at the bottom of the row and working to the top
+        if (this->tileSpaces[i][colNum] == -1) {
+          return this->hashKey ^ zobristKey(i, colNum, this->nextPlayer());
+        }
+      }
+      return this->hashKey;
+    }
+
+    // Marks entry as proven if the proven values of this position's children decide it (MCTS-Solver), returns true if it was proven
+    template <class Table>
+    bool proveFromChildren(Table& table, TTEntry& entry){
+      /*
+      The position is a proven loss for playerJustMoved if any child is a proven win for the player to move.
+      If every child is proven, the value is the best one the player to move can reach.
+      */
+      int bestValue = -2;   // Best proven child value for the player to move (-2 = none yet)
+      int bestDepth = 0;
+      bool allProven = true;
+
+      for (int i = 0; i < 7; i++){   // For each column
+        if (!this->isPossible(i)){
+          continue;
+        }
+        TTEntry child;
+        if (!table.probe(this->childHash(i), child) || !child.isProven){
+          allProven = false;
+          continue;
+        }
+        int depth = child.provenDepth + 1;
+        // Win as fast as possible, lose as slowly as possible
+        if (child.provenValue > bestValue || (child.provenValue == bestValue && (bestValue == 1 ? depth < bestDepth : depth > bestDepth))){
+          bestValue = child.provenValue;
+          bestDepth = depth;
+        }
+      }
+
+      if (bestValue == 1 || (allProven && bestValue != -2)){
+        entry.isProven = true;
+        entry.provenValue = -bestValue;
+        entry.provenDepth = bestDepth;
+        return true;
+      }
+      return false;
+    }
+
+    // Converts a proven entry for this position into a getGameState() style result (winning player number, or 3 for a draw)
+    int provenResult(const TTEntry& entry){
+      if (entry.provenValue == 1){
+        return this->playerJustMoved;
+      }
+      else if (entry.provenValue == -1){
+        return this->nextPlayer();
+      }
+      return 3;
+    }
+
+    // Runs UCT over the DAG of positions reachable from this Node, with statistics shared through table
+    template <class Table>
+    long long searchDAG(Table& table, const SearchSettings& settings, c4Generator& generator){    // Runs settings.iterations playouts
+      return this->searchDAG(table, settings, SearchLimits::playouts(settings.iterations), generator);
+    }
+
+    // Number of empty cells below which searchDAG() solves new leaves exactly, larger for larger budgets
+    static int leafSolverThreshold(const SearchSettings& settings, const SearchLimits& limits){
+      /*
+      Solving costs roughly 3 times more for each extra empty cell, so the threshold grows with the log of the budget
+      (in playouts, about 100 per millisecond): 13 for 10000 playouts, 16 for a second, 19 for ten seconds.
+      */
+      if (settings.leafSolverEmpties >= 0){
+        return settings.leafSolverEmpties;
+      }
+      double budget = settings.iterations;
+      if (limits.maxPlayouts >= 0){
+        budget = limits.maxPlayouts;
+      }
+      else if (limits.useDeadline){
+        budget = 100.0 * chrono::duration_cast<chrono::milliseconds>(limits.deadline - chrono::steady_clock::now()).count();
+      }
+      else if (limits.maxNodes >= 0){
+        budget = limits.maxNodes / 20.0;   // About 20 positions per playout
+      }
+      int threshold = 10 + static_cast<int>(log2(max(budget, 1.0) / 1000));
+      return min(max(threshold, 8), 20);
+    }
+
+    // Runs UCT over the DAG of positions until a limit is reached, returns the number of playouts done
+    template <class Table>    // TranspositionTable or LocklessTranspositionTable
+    long long searchDAG(Table& table, const SearchSettings& settings, const SearchLimits& limits, c4Generator& generator){
+      /*
+      1. Starting at this position, select the child with the highest UCT value (child statistics come from the table, so every path to a position shares them)
+      2. When a child that has never been visited is reached, add it to the table and do a playout from it
+      3. Backpropagate the result to every position on the path (entries are read, updated and stored again by key, in case an entry was replaced in the meantime)
+      4. With useSolver, terminal positions are proven and proofs are propagated up the path. Proven children are skipped during selection
+      5. With useRave, every position on the path also records the columns its player to move played later in the iteration (AMAF)
+      6. With useSolver, new positions with at most leafSolverThreshold() empty cells are solved exactly and proven instead of played out
+      */
+      const array<int, 7> columnOrder = {3, 2, 4, 1, 5, 0, 6};   // Unvisited children are expanded center first
+      vector<Node> path;    // Positions visited during this iteration
+      vector<int> moves;    // Columns played during this iteration (moves[k] was played from path[k], then the playout moves)
+      int leafSolverEmpties = settings.useSolver ? leafSolverThreshold(settings, limits) : 0;
+      unique_ptr<SolverTable> solverTable;    // Created by the first leaf that is solved
+
+      long long playoutCount = 0;
+      long long nodeCount = 0;
+      table.touch(this->hashKey);
+      while (!limits.reached(playoutCount, nodeCount)){
+        if (settings.useSolver){
+          TTEntry rootEntry;
+          if (table.probe(this->hashKey, rootEntry) && rootEntry.isProven){    // Nothing left to search
+            break;
+          }
+        }
+        playoutCount ++;
+
+        path.clear();
+        moves.clear();
+        path.push_back(*this);
+        int results = this->getGameState();
+
+        // Selection (and expansion of one new position)
+        while (results == -1){
+          Node& current = path.back();
+          TTEntry parent;
+          bool parentFound = table.probe(current.hashKey, parent);
+          double logParentVisits = log(max(parentFound ? parent.ni : 1, 1));
+          int bestCol = -1;
+          double bestValue = -1;
+          bool expanded = false;
+          bool winningChild = false;    // A child is a proven win for the player to move
+
+          for (int k = 0; k < 7; k++){
+            int col = columnOrder[k];
+            if (!current.isPossible(col)){
+              continue;
+            }
+            TTEntry child;
+            if (!table.probe(current.childHash(col), child) || child.ni == 0){    // Never visited from any path: expand it
+              bestCol = col;
+              expanded = true;
+              break;
+            }
+            if (settings.useSolver && child.isProven){   // Proven subtrees are not searched again
+              winningChild = winningChild || child.provenValue == 1;
+              continue;
+            }
+            double value = (child.wi + 0.5 * child.di) / child.ni;
+            if (settings.useRave && parentFound && parent.amafN[col] > 0){
+              // Weight of the AMAF value decays as the child gets visits of its own
+              double beta = sqrt(settings.raveEquivalence / (3 * child.ni + settings.raveEquivalence));
+              double amafValue = (parent.amafW[col] + 0.5 * parent.amafD[col]) / parent.amafN[col];
+              value = (1 - beta) * value + beta * amafValue;
+            }
+            value += settings.explorationConstant * sqrt(logParentVisits / child.ni);
+            if (value > bestValue){
+              bestValue = value;
+              bestCol = col;
+            }
+          }
+
+          // Every child is proven (or one of them wins): this position is proven too
+          if (settings.useSolver && !expanded && (winningChild || bestCol == -1)){
+            TTEntry entry;
+            if (!table.probe(current.hashKey, entry)){
+              entry.key = current.hashKey;
+            }
+            if (current.proveFromChildren(table, entry)){
+              table.store(entry);
+              results = current.provenResult(entry);
+            }
+            else{
+              results = current.playout(generator, nullptr, &nodeCount, settings.tablebase);   // Proven children were replaced in the table
+            }
+            break;
+          }
+
+          Node child = current.getChildNode(bestCol);
+          nodeCount ++;
+          table.touch(child.hashKey);
+          results = child.getGameState();
+          if (settings.useSolver && results != -1){   // Terminal positions are proven (the last mover won or it is a draw)
+            TTEntry childEntry;
+            if (!table.probe(child.hashKey, childEntry)){
+              childEntry.key = child.hashKey;
+            }
+            childEntry.isProven = true;
+            childEntry.provenValue = (results == 3) ? 0 : 1;
+            childEntry.provenDepth = 0;
+            table.store(childEntry);
+          }
+          path.push_back(child);
+          moves.push_back(bestCol);
+
+          if (expanded && results == -1 && child.movesLeft() <= leafSolverEmpties){    // Exact value instead of a playout
+            if (solverTable == nullptr){
+              solverTable.reset(new SolverTable(1));
+            }
+            Solver solver(solverTable.get());
+            BitboardPosition position = child.bitboard();
+            int score = solver.solve(position);    // For the player to move in child
+            nodeCount += solver.nodeCount;
+            TTEntry childEntry;
+            if (!table.probe(child.hashKey, childEntry)){
+              childEntry.key = child.hashKey;
+            }
+            childEntry.isProven = true;
+            childEntry.provenValue = (score > 0) ? -1 : (score < 0 ? 1 : 0);
+            int winnerMoves = Solver::movesToEnd(position, score);
+            childEntry.provenDepth = (score > 0) ? 2 * winnerMoves - 1 : (score < 0 ? 2 * winnerMoves : child.movesLeft());
+            table.store(childEntry);
+            results = child.provenResult(childEntry);
+            break;
+          }
+          if (expanded && results == -1){
+            results = child.playout(generator, settings.useRave ? &moves : nullptr, &nodeCount, settings.tablebase);   // Simulation
+            break;
+          }
+        }
+
+        // Backpropagation
+        for (size_t k = 0; k < path.size(); k++){
+          TTEntry entry;
+          if (!table.probe(path[k].hashKey, entry)){
+            continue;
+          }
+          entry.ni ++;
+          if (results == path[k].playerJustMoved){
+            entry.wi ++;
+          }
+          else if (results == 3){
+            entry.di ++;
+          }
+
+          // AMAF: the first time each column was played by this position's player to move
+          if (settings.useRave){
+            array<bool, 7> seen;
+            seen.fill(false);
+            for (size_t j = k; j < moves.size(); j += 2){
+              int col = moves[j];
+              if (seen[col]){
+                continue;
+              }
+              seen[col] = true;
+              entry.amafN[col] ++;
+              if (results == path[k].nextPlayer()){
+                entry.amafW[col] ++;
+              }
+              else if (results == 3){
+                entry.amafD[col] ++;
+              }
+            }
+          }
+          table.store(entry);
+        }
+
+        // Propagate proofs towards the root until a position can't be proven
+        if (settings.useSolver){
+          for (int k = path.size() - 2; k >= 0; k--){
+            TTEntry entry;
+            TTEntry below;
+            if (!table.probe(path[k].hashKey, entry) || !table.probe(path[k + 1].hashKey, below) || !below.isProven || entry.isProven){
+              break;
+            }
+            if (!path[k].proveFromChildren(table, entry)){
+              break;
+            }
+            table.store(entry);
+          }
+        }
+      }
+      return playoutCount;
+    }
+
+    // Splits budget playouts between the root moves by sequential halving, returns the surviving column
+    int sequentialHalving(long long budget, const function<void(int, long long)>& sample, const function<double(int)>& value){
+      long long used = 0;
+      return this->sequentialHalving([&](){ return budget - used; }, [&](int col, long long n){ sample(col, n); used += n; }, value);
+    }
+
+    // Sequential halving while remaining() (the playouts left before a limit is reached) is positive
+    int sequentialHalving(const function<long long()>& remaining, const function<void(int, long long)>& sample, const function<double(int)>& value){
+      /*
+      sample(col, n) runs n more playouts for a column and value(col) returns its current estimate.
+      1. Every remaining candidate gets remaining() / (candidates * rounds left) playouts
+      2. The worse half of the candidates (by value) is dropped
+      3. Repeat until one candidate is left (rounds = ceil(log2(legal moves)))
+      Once nothing remains, more rounds would only sort statistics that no longer change: the best candidate so far is returned.
+      */
+      vector<int> candidates;
+      for (int i = 0; i < 7; i++){   // For each column
+        if (this->isPossible(i)){
+          candidates.push_back(i);
+        }
+      }
+      int roundsLeft = max(1, static_cast<int>(ceil(log2(candidates.size()))));
+      auto better = [&](int a, int b){ return value(a) > value(b); };
+
+      while (candidates.size() > 1){
+        long long left = remaining();
+        if (left <= 0){
+          break;
+        }
+        long long perCandidate = max(1LL, left / static_cast<long long>(candidates.size() * roundsLeft));
+        for (int col : candidates){
+          sample(col, perCandidate);
+        }
+        stable_sort(candidates.begin(), candidates.end(), better);
+        candidates.resize((candidates.size() + 1) / 2);
+        roundsLeft = max(1, roundsLeft - 1);
+      }
+      stable_sort(candidates.begin(), candidates.end(), better);
+      return candidates[0];
+    }
+
+    // Playouts left before limits are reached, for sequentialHalving(): the playout limit, else the time left at the rate
+    // measured so far (100 per millisecond until a millisecond has passed), else settings.iterations
+    static function<long long()> remainingPlayouts(const SearchSettings& settings, const SearchLimits& limits, const long long& playoutCount){
+      chrono::steady_clock::time_point start = chrono::steady_clock::now();
+      return [&settings, &limits, &playoutCount, start]() -> long long {
+        if (limits.stopFlag != nullptr && limits.stopFlag->load(memory_order_relaxed)){
+          return 0;
+        }
+        if (limits.maxPlayouts >= 0){
+          return limits.maxPlayouts - playoutCount;
+        }
+        if (limits.useDeadline){
+          chrono::steady_clock::time_point now = chrono::steady_clock::now();
+          double millisecondsLeft = chrono::duration<double, milli>(limits.deadline - now).count();
+          double millisecondsUsed = chrono::duration<double, milli>(now - start).count();
+          double rate = (playoutCount > 0 && millisecondsUsed >= 1) ? playoutCount / millisecondsUsed : 100;
+          return millisecondsLeft <= 0 ? 0 : max(1LL, static_cast<long long>(millisecondsLeft * rate));
+        }
+        return settings.iterations - playoutCount;
+      };
+    }
+
+    // Collects the statistics of each move from this position out of table
+    template <class Table>
+    RootStatistics rootStatistics(Table& table, const SearchSettings& settings){
+      RootStatistics stats;
+      for (int i = 0; i < 7; i++){   // For each column
+        TTEntry child;
+        if (!this->isPossible(i) || !table.probe(this->childHash(i), child)){
+          continue;
+        }
+        stats.ni[i] = child.ni;
+        stats.wi[i] = child.wi;
+        stats.di[i] = child.di;
+        if (settings.useSolver && child.isProven){
+          stats.provenValue[i] = child.provenValue;
+          stats.provenDepth[i] = child.provenDepth;
+        }
+      }
+      return stats;
+    }
+
+    // Searches the DAG of positions stored in table (with sequential halving at the root if enabled)
+    template <class Table>
+    RootStatistics searchRootDAG(Table& table, const SearchSettings& settings, const SearchLimits& limits, c4Generator& generator){
+      long long playoutCount = 0;
+      int halvingChoice = -1;
+      if (settings.useSequentialHalving){
+        // Each round searches the candidate's subtree, sharing the same table (the node budget is not used)
+        halvingChoice = this->sequentialHalving(remainingPlayouts(settings, limits, playoutCount),
+          [&](int col, long long n){
+            SearchLimits roundLimits = limits;
+            roundLimits.maxPlayouts = n;
+            roundLimits.maxNodes = -1;
+            playoutCount += this->getChildNode(col).searchDAG(table, settings, roundLimits, generator);
+          },
+          [&](int col){
+            TTEntry child;
+            if (!table.probe(this->childHash(col), child) || child.ni == 0){
+              return 0.0;
+            }
+            if (settings.useSolver && child.isProven){
+              return child.provenValue == 1 ? 2.0 : (child.provenValue == -1 ? -1.0 : 0.5);
+            }
+            return (child.wi + 0.5 * child.di) / child.ni;
+          });
+      }
+      else{
+        playoutCount = this->searchDAG(table, settings, limits, generator);
+      }
+
+      RootStatistics stats = this->rootStatistics(table, settings);
+      stats.halvingChoice = halvingChoice;
+      stats.playouts = playoutCount;
+      return stats;
+    }
+
+    // Runs one search from this position and returns the statistics of each move (table is only used when settings.useTranspositions is true)
+    RootStatistics searchRoot(const SearchSettings& settings, const SearchLimits& limits, TranspositionTable* table, c4Generator& generator){
+      // Search the DAG of positions
+      if (settings.useTranspositions){
+        if (settings.sharedTable != nullptr){   // newSearch() is called once per move by makeMove(), not by every thread
+          return this->searchRootDAG(*settings.sharedTable, settings, limits, generator);
+        }
+        if (!settings.pondered){
+          table->newSearch();
+        }
+        return this->searchRootDAG(*table, settings, limits, generator);
+      }
+
+      // Flat sampling of each column
+      vector<Node> childrenNodes;   // Create a list to keep track of each child Node
+      Node placeholder;   // Default state for Node (used as placeholder in vectors and stuff)
+
+      // Generate childrenNodes for all possible moves
+      for (int i = 0; i < 7; i++){   // For each column
+        if (this->isPossible(i)){    // Check if a move is possble
+          Node tmp;   // Create a temporary Node obeject
+          tmp = *this;    // Give tmp the same starting paramters as current instance
+          tmp = tmp.getChildNode(i);   // Convert tmp into a child node
+          childrenNodes.push_back(tmp);   // Append tmp to the list of child nodes
+        }
+        else{
+          childrenNodes.push_back(placeholder);  // If a move wasn't possible, give it a placeholder value since index of node is column of move
+        }
+      }
+
+      // Sample the child Nodes one playout at a time (round robin) until a limit is reached
+      long long playoutCount = 0;
+      long long nodeCount = 0;
+      int halvingChoice = -1;
+      if (settings.useSequentialHalving){   // Or concentrate them on the best moves
+        halvingChoice = this->sequentialHalving(remainingPlayouts(settings, limits, playoutCount),
+          [&](int col, long long n){
+            for (long long k = 0; k < n && !limits.reached(playoutCount, -1); k++){
+              childrenNodes[col].addResult(childrenNodes[col].playout(generator, nullptr, nullptr, settings.tablebase));
+              playoutCount ++;
+            }
+          },
+          [&](int col){
+            return (childrenNodes[col].wi + 0.5 * childrenNodes[col].di) / max(childrenNodes[col].ni, 1);
+          });
+      }
+      for (int i = 0; halvingChoice == -1 && !limits.reached(playoutCount, nodeCount); i = (i + 1) % 7){
+        if (this->isPossible(i)){
+          childrenNodes[i].addResult(childrenNodes[i].playout(generator, nullptr, &nodeCount, settings.tablebase));    // Updates wi for each node
+          playoutCount ++;
+        }
+      }
+
+      RootStatistics stats;
+      for (int i = 0; i < 7; i++){
+        if (this->isPossible(i)){
+          stats.ni[i] = childrenNodes[i].ni;
+          stats.wi[i] = childrenNodes[i].wi;
+          stats.di[i] = childrenNodes[i].di;
+        }
+      }
+      stats.halvingChoice = halvingChoice;
+      stats.playouts = playoutCount;
+      return stats;
+    }
+
+    // Runs settings.threads independent searches of this position at once (root parallelism) and sums their statistics
+    RootStatistics searchRootParallel(const SearchSettings& settings, const SearchLimits& limits, unsigned seed){
+      /*
+      Every thread gets its own copy of the root, its own random number stream and its own TranspositionTable.
+      Playout and node budgets are split between the threads, deadlines are shared.
+      */
+      int numThreads = max(settings.threads, 1);
+      SearchLimits threadLimits = limits;
+      if (limits.maxPlayouts >= 0){
+        threadLimits.maxPlayouts = (limits.maxPlayouts + numThreads - 1) / numThreads;
+      }
+      if (limits.maxNodes >= 0){
+        threadLimits.maxNodes = (limits.maxNodes + numThreads - 1) / numThreads;
+      }
+
+      vector<RootStatistics> results(numThreads);
+      auto search = [&](int t){
+        Node root = *this;
+        c4Generator generator (seed + t * 0x9E3779B9U);
+        TranspositionTable *table = (t == 0) ? settings.table : nullptr;   // The first thread keeps using the game's table
+        unique_ptr<TranspositionTable> localTable;
+        if (table == nullptr && settings.useTranspositions && settings.sharedTable == nullptr){
+          localTable.reset(new TranspositionTable(settings.tableSizeMB));
+          table = localTable.get();
+        }
+        results[t] = root.searchRoot(settings, threadLimits, table, generator);
+      };
+
+      if (settings.pool != nullptr){   // Each search is a pool task
+        TaskGroup group;
+        for (int t = 0; t < numThreads; t++){
+          settings.pool->submit(group, [&search, t](){ search(t); });
+        }
+        settings.pool->wait(group);
+      }
+      else{
+        vector<thread> workers;
+        for (int t = 0; t < numThreads; t++){
+          workers.push_back(thread(search, t));
+        }
+        for (int t = 0; t < numThreads; t++){
+          workers[t].join();
+        }
+      }
+
+      RootStatistics merged;
+      for (int t = 0; t < numThreads; t++){
+        merged.add(results[t]);
+      }
+      return merged;
+    }
+
+    // Flat sampling split into tasks of settings.playoutsPerTask playouts on settings.pool (playouts vary a lot in length, so idle workers steal tasks)
+    RootStatistics sampleFlatParallel(const SearchSettings& settings, const SearchLimits& limits, unsigned seed){
+      vector<int> legalMoves;
+      for (int i = 0; i < 7; i++){   // For each column
+        if (this->isPossible(i)){
+          legalMoves.push_back(i);
+        }
+      }
+
+      RootStatistics stats;
+      mutex statsLock;
+      atomic<long long> claimedPlayouts (0);    // Playouts handed out to tasks so far
+      atomic<long long> nodeCount (0);
+      atomic<long long> nextChunk (0);          // Chunks go to the columns round robin
+      TaskGroup group;
+
+      // Every task samples one chunk, then submits its successor while the limits allow it
+      function<void()> sampleChunk = [&](){
+        long long chunk = nextChunk++;
+        int col = legalMoves[chunk % legalMoves.size()];
+        Node root = *this;    // getChildNode() writes to the Node it is called on
+        Node child = root.getChildNode(col);
+        c4Generator generator (seed + chunk * 0x9E3779B9U);
+        long long chunkNodes = 0;
+        int done = 0;
+        for (; done < settings.playoutsPerTask; done++){
+          if (limits.reached(claimedPlayouts++, nodeCount.load(memory_order_relaxed) + chunkNodes)){
+            break;
+          }
+          child.addResult(child.playout(generator, nullptr, &chunkNodes, settings.tablebase));
+        }
+        nodeCount += chunkNodes;
+        {
+          lock_guard<mutex> guard(statsLock);
+          stats.ni[col] += child.ni;
+          stats.wi[col] += child.wi;
+          stats.di[col] += child.di;
+          stats.playouts += done;
+        }
+        if (done == settings.playoutsPerTask){
+          settings.pool->submit(group, sampleChunk);
+        }
+      };
+
+      for (int i = 0; i < settings.pool->size() * 2; i++){
+        settings.pool->submit(group, sampleChunk);
+      }
+      settings.pool->wait(group);
+      return stats;
+    }
+
+    // Searches one tree shared by settings.threads threads and returns the statistics of each move
+    RootStatistics searchSharedTree(const SearchSettings& settings, const SearchLimits& limits, unsigned seed, SharedTreeCounters& counters){
+      /*
+      Node statistics are atomic counters. While a thread is below a node, the node carries a virtual loss so that other
+      threads prefer different paths. Children are created by compare-and-swap on the empty child slot: the thread that loses
+      the race deletes its node and follows the winner's.
+      Nodes less than settings.shardDepth moves below the root keep their counters per thread (see SharedTreeNode).
+      */
+      const array<int, 7> columnOrder = {3, 2, 4, 1, 5, 0, 6};   // Unvisited children are expanded center first
+      int numThreads = max(settings.threads, 1);
+      size_t shardDepth = max(settings.shardDepth, 0);
+      SharedTreeNode root(shardDepth > 0 ? numThreads : 0);
+
+      auto worker = [&](int t){
+        c4Generator generator (seed + t * 0x9E3779B9U);
+        vector<SharedTreeNode*> path;   // Tree nodes visited during this iteration
+        vector<int> pathPlayers;        // playerJustMoved for each of them
+        long long virtualLossHits = 0;
+        long long expansionCollisions = 0;
+
+        while (!limits.reached(counters.playouts.fetch_add(1), counters.nodes.load(memory_order_relaxed))){
+          Node current = *this;
+          SharedTreeNode* node = &root;
+          path.clear();
+          pathPlayers.clear();
+          path.push_back(node);
+          pathPlayers.push_back(current.playerJustMoved);
+          node->addVirtualLoss(t, 1);
+          int results = current.getGameState();
+
+          // Selection (and expansion of one new node)
+          while (results == -1){
+            double logParentVisits = log(max(node->visits() + node->inFlight(), 1));
+            int bestCol = -1;
+            double bestValue = -1;
+            bool expanding = false;
+
+            for (int k = 0; k < 7; k++){
+              int col = columnOrder[k];
+              if (!current.isPossible(col)){
+                continue;
+              }
+              SharedTreeNode* child = node->children[col].load(memory_order_acquire);
+              if (child == nullptr){
+                bestCol = col;
+                expanding = true;
+                break;
+              }
+              int inFlight = child->inFlight();
+              if (inFlight > 0){
+                virtualLossHits ++;
+              }
+              int visits = child->visits() + inFlight;
+              if (visits == 0){
+                bestCol = col;
+                break;
+              }
+              double value = (child->wins() + 0.5 * child->draws()) / visits + settings.explorationConstant * sqrt(logParentVisits / visits);
+              if (value > bestValue){
+                bestValue = value;
+                bestCol = col;
+              }
+            }
+
+            SharedTreeNode* child;
+            if (expanding){
+              if (counters.nodes.load(memory_order_relaxed) >= settings.maxTreeNodes){
+                results = current.playout(generator, nullptr, nullptr, settings.tablebase);   // The tree is full
+                break;
+              }
+              SharedTreeNode* fresh = new SharedTreeNode(path.size() < shardDepth ? numThreads : 0);   // path.size() = depth of the child
+              SharedTreeNode* expected = nullptr;
+              if (node->children[bestCol].compare_exchange_strong(expected, fresh, memory_order_acq_rel)){
+                counters.nodes.fetch_add(1, memory_order_relaxed);
+                child = fresh;
+              }
+              else{
+                delete fresh;
+                expansionCollisions ++;
+                child = expected;   // Follow the node the other thread created
+              }
+            }
+            else{
+              child = node->children[bestCol].load(memory_order_acquire);
+            }
+
+            child->addVirtualLoss(t, 1);
+            current = current.getChildNode(bestCol);
+            node = child;
+            path.push_back(node);
+            pathPlayers.push_back(current.playerJustMoved);
+            results = current.getGameState();
+
+            if (expanding && results == -1){
+              results = current.playout(generator, nullptr, nullptr, settings.tablebase);   // Simulation
+              break;
+            }
+          }
+
+          // Backpropagation (and removal of the virtual loss)
+          for (size_t k = 0; k < path.size(); k++){
+            path[k]->addResult(t, results == pathPlayers[k], results == 3);
+            path[k]->addVirtualLoss(t, -1);
+          }
+        }
+        counters.virtualLossHits += virtualLossHits;
+        counters.expansionCollisions += expansionCollisions;
+      };
+
+      if (settings.pool != nullptr){   // Each worker is a pool task (on a smaller pool the later ones find the limits reached)
+        TaskGroup group;
+        for (int t = 0; t < numThreads; t++){
+          settings.pool->submit(group, [&worker, t](){ worker(t); });
+        }
+        settings.pool->wait(group);
+      }
+      else{
+        vector<thread> workers;
+        for (int t = 0; t < numThreads; t++){
+          workers.push_back(thread(worker, t));
+        }
+        for (int t = 0; t < numThreads; t++){
+          workers[t].join();
+        }
+      }
+
+      RootStatistics stats;
+      for (int i = 0; i < 7; i++){
+        SharedTreeNode* child = root.children[i].load();
+        if (child != nullptr){
+          stats.ni[i] = child->visits();
+          stats.wi[i] = child->wins();
+          stats.di[i] = child->draws();
+        }
+      }
+      stats.playouts = root.visits();
+      return stats;
+    }
+
+    // Number of move sequences of length depth from this position (a game that is over isn't continued)
+    long long perft(int depth){
+      if (depth == 0){
+        return 1;
+      }
+      if (this->getGameState() != -1){
+        return 0;
+      }
+      long long count = 0;
+      for (int col = 0; col < 7; col++){
+        if (this->isPossible(col)){
+          Node parent = *this;    // getChildNode() writes to the Node it is called on
+          count += parent.getChildNode(col).perft(depth - 1);
+        }
+      }
+      return count;
+    }
+
+    // This position for the exact solver
+    BitboardPosition bitboard(){
+      return BitboardPosition(this->tileSpaces, this->nextPlayer());
+    }
+
+    // Chooses the move with the best exact score (fastest win, else a draw, else the slowest loss), -1 if limits were reached first
+    int solveMove(const SearchSettings& settings, const SearchLimits& limits){
+      /*
+      With settings.solverWeak only wins, draws and losses are told apart: the first winning move (center first) is
+      played without solving the others, and the game may take longer to win than necessary.
+      */
+      SolverTable table(settings.solverTableMB);
+      Solver solver(&table);
+      solver.limits = &limits;
+      BitboardPosition position = this->bitboard();
+      array<int, 7> scores;
+      scores.fill(Solver::INVALID_MOVE);
+      int bestMove = -1;
+      for (int col : {3, 2, 4, 1, 5, 0, 6}){
+        if (!position.canPlay(col)){
+          continue;
+        }
+        if (position.isWinningMove(col)){
+          scores[col] = settings.solverWeak ? 1 : (BitboardPosition::WIDTH * BitboardPosition::HEIGHT + 1 - position.moves) / 2;
+        }
+        else{
+          BitboardPosition child = position;
+          child.play(col);
+          if (child.moves == BitboardPosition::WIDTH * BitboardPosition::HEIGHT){
+            scores[col] = 0;
+          }
+          else if (settings.threads > 1 && !settings.deterministic){   // Lazy SMP threads race, so the counts reported vary
+            int score = Solver::solveParallel(child, settings.solverWeak, settings.threads, &table, &solver.nodeCount, &limits);
+            if (score == Solver::INTERRUPTED){
+              bestMove = -1;
+              break;
+            }
+            scores[col] = -score;
+          }
+          else{
+            scores[col] = -solver.solve(child, settings.solverWeak);
+            if (solver.stopped()){
+              bestMove = -1;
+              break;
+            }
+          }
+        }
+        if (bestMove == -1 || scores[col] > scores[bestMove]){
+          bestMove = col;
+        }
+        if (settings.solverWeak && scores[col] == 1){
+          break;
+        }
+      }
+      if (bestMove == -1){
+        if (settings.verbose){
+          cout << "Solve interrupted after " << solver.nodeCount << " positions" << endl;
+        }
+        return -1;
+      }
+      if (settings.verbose){
+        int score = scores[bestMove];
+        if (settings.solverWeak){
+          cout << "Solved: " << (score > 0 ? "forced win" : (score < 0 ? "forced loss" : "draw")) << endl;
+        }
+        else if (score > 0){
+          cout << "Solved: forced win in " << Solver::movesToEnd(position, score) << endl;
+        }
+        else if (score < 0){
+          cout << "Solved: forced loss in " << Solver::movesToEnd(position, score) << endl;
+        }
+        else{
+          cout << "Solved: draw" << endl;
+        }
+        cout << "Positions solved: " << solver.nodeCount << ", table hit rate " << table.hitRate() << endl;
+      }
+      return bestMove;
+    }
+
+    // Splits the search between the live ProcessWorkers (falls back to searching here if none are left)
+    RootStatistics searchRootProcesses(ProcessWorkers& workers, const SearchSettings& settings, const SearchLimits& limits, unsigned seed){
+      /*
+      Request: <42 tiles, row by row, '.'/'R'/'Y'> <playerJustMoved> <playouts> <nodes> <milliseconds left> <seed>   (-1 = no limit)
+      Reply:   <playouts> followed by <ni> <wi> <di> <provenValue> <provenDepth> for each column
+      Budgets are split between the live workers like searchRootParallel() splits them between threads
+      */
+      int alive = workers.alive();
+      if (alive > 0){
+        string board;
+        for (size_t i = 0; i < this->tileSpaces.size(); i++){
+          for (size_t j = 0; j < this->tileSpaces[i].size(); j++){
+            board += ".RY"[max(this->tileSpaces[i][j], 0)];     // -1 (empty) -> ., 1 -> R, 2 -> Y
+          }
+        }
+        long long milliseconds = -1;
+        if (limits.useDeadline){
+          milliseconds = max(0LL, static_cast<long long>(chrono::duration_cast<chrono::milliseconds>(limits.deadline - chrono::steady_clock::now()).count()));
+        }
+        vector<string> requests;
+        for (int w = 0; w < workers.size(); w++){
+          stringstream request;
+          request << board << " " << this->playerJustMoved << " "
+                  << (limits.maxPlayouts >= 0 ? (limits.maxPlayouts + alive - 1) / alive : -1) << " "
+                  << (limits.maxNodes >= 0 ? (limits.maxNodes + alive - 1) / alive : -1) << " "
+                  << milliseconds << " " << seed + w * 0x9E3779B9U;
+          requests.push_back(request.str());
+        }
+
+        // Wait for the deadline plus a second for the workers to answer, otherwise as long as they are alive
+        vector<string> replies = workers.exchange(requests, milliseconds >= 0 ? milliseconds + 1000 : -1);
+        RootStatistics merged;
+        bool answered = false;
+        for (const string& reply : replies){
+          stringstream fields(reply);
+          RootStatistics stats;
+          if (!(fields >> stats.playouts)){
+            continue;
+          }
+          for (int i = 0; i < 7; i++){
+            fields >> stats.ni[i] >> stats.wi[i] >> stats.di[i] >> stats.provenValue[i] >> stats.provenDepth[i];
+          }
+          if (fields){
+            merged.add(stats);
+            answered = true;
+          }
+        }
+        if (answered){
+          return merged;
+        }
+      }
+
+      SearchSettings local = settings;    // Every worker is gone
+      local.processes = nullptr;
+      local.threads = 1;
+      TranspositionTable table(settings.tableSizeMB);
+      c4Generator generator (seed);
+      return this->searchRoot(local, limits, &table, generator);
+    }
+
+    // Runs the search a searchRootProcesses() request asks for (in a worker process), returns the reply
+    static string answerSearchRequest(const string& request, const SearchSettings& settings, TranspositionTable* table){
+      stringstream fields(request);
+      string board;
+      int playerJustMoved;
+      long long playouts, nodes, milliseconds;
+      unsigned seed;
+      if (!(fields >> board >> playerJustMoved >> playouts >> nodes >> milliseconds >> seed) || board.size() != 42){
+        return "error";
+      }
+      Node root;
+      for (int k = 0; k < 42; k++){
+        root.tileSpaces[k / 7][k % 7] = board[k] == 'R' ? 1 : (board[k] == 'Y' ? 2 : -1);
+      }
+      root.playerJustMoved = playerJustMoved;
+      root.hashKey = positionHash(root.tileSpaces);
+
+      SearchLimits limits;
+      limits.maxPlayouts = playouts;
+      limits.maxNodes = nodes;
+      if (milliseconds >= 0){
+        limits = SearchLimits::until(chrono::steady_clock::now() + chrono::milliseconds(milliseconds));
+        limits.maxPlayouts = playouts;
+        limits.maxNodes = nodes;
+      }
+      SearchSettings local = settings;
+      local.threads = 1;
+      local.pool = nullptr;
+      local.sharedTable = nullptr;
+      local.processes = nullptr;
+      c4Generator generator (seed);
+      RootStatistics stats = root.searchRoot(local, limits, table, generator);
+
+      stringstream reply;
+      reply << stats.playouts;
+      for (int i = 0; i < 7; i++){
+        reply << " " << stats.ni[i] << " " << stats.wi[i] << " " << stats.di[i] << " " << stats.provenValue[i] << " " << stats.provenDepth[i];
+      }
+      return reply.str();
+    }
+
+    // Runs a search whose statistics only depend on settings.seed, settings.threads, the limits and this position
+    RootStatistics searchDeterministic(const SearchSettings& settings, const SearchLimits& limits){
+      /*
+      Everything that depends on thread timing is turned off:
+      - Each thread searches its own fixed share of the playout/node budget with its own table (no shared table or tree)
+        and the results are merged in thread order (searchRootParallel())
+      - Deadlines and stop flags are ignored, a search without a playout or node budget gets settings.iterations playouts
+      - The seed comes from settings.seed and the position instead of the clock
+      */
+      SearchSettings fixed = settings;
+      fixed.sharedTable = nullptr;
+      fixed.useSharedTree = false;
+      SearchLimits fixedLimits = limits;
+      fixedLimits.useDeadline = false;
+      fixedLimits.stopFlag = nullptr;
+      if (fixedLimits.maxPlayouts < 0 && fixedLimits.maxNodes < 0){
+        fixedLimits.maxPlayouts = settings.iterations;
+      }
+      unsigned seed = settings.seed ^ static_cast<unsigned>(this->hashKey ^ (this->hashKey >> 32));
+      if (fixed.processes != nullptr){    // Workers are numbered, their replies are merged in order
+        return this->searchRootProcesses(*fixed.processes, fixed, fixedLimits, seed);
+      }
+      if (fixed.threads > 1){
+        return this->searchRootParallel(fixed, fixedLimits, seed);
+      }
+      TranspositionTable *table = settings.table;
+      unique_ptr<TranspositionTable> localTable;
+      if (table == nullptr && settings.useTranspositions){
+        localTable.reset(new TranspositionTable(settings.tableSizeMB));
+        table = localTable.get();
+      }
+      c4Generator generator (seed);
+      return this->searchRoot(fixed, fixedLimits, table, generator);
+    }
+
+    // Picks the best move from stats, updates this Node's accumulators and prints the estimates
+    int chooseMove(const RootStatistics& stats, const SearchSettings& settings){
+      /*
+      A proven win is always taken (fastest first) and a proven loss only if nothing else is left (slowest first).
+      Otherwise: the column chosen by sequential halving, else the most visited column (DAG) or the one with the most wins (flat sampling)
+      */
+      int bestMove = -1;
+      long long bestScore = -1;
+      int bestRank = -2;    // 1 = proven win, 0 = not a proven loss, -1 = proven loss
+      int bestDepth = 0;
+      for (int i = 0; i < 7; i++){   // For each column
+        if (!this->isPossible(i)){
+          continue;
+        }
+        // Update root node's accumulators
+        this->ni += stats.ni[i];
+        this->wi += stats.wi[i];
+        this->di += stats.di[i];
+
+        long long score = settings.useTranspositions ? stats.ni[i] : stats.wi[i];
+        if (stats.halvingChoice != -1){
+          score = (i == stats.halvingChoice) ? 1 : 0;   // Sequential halving already chose between the moves
+        }
+        int rank = stats.provenValue[i];
+        int depth = stats.provenDepth[i];
+
+        bool better = rank > bestRank;
+        if (rank == bestRank){
+          if (rank == 1){
+            better = depth < bestDepth;   // Fastest win
+          }
+          else if (rank == -1){
+            better = depth > bestDepth;   // Slowest loss
+          }
+          else{
+            better = score > bestScore;
+          }
+        }
+        if (better){
+          bestScore = score;
+          bestMove = i;
+          bestRank = rank;
+          bestDepth = depth;
+        }
+      }
+
+      if (!settings.verbose){
+        return bestMove;
+      }
+      if (bestRank == 1){
+        cout << "Forced win in " << (bestDepth + 2) / 2 << endl;    // Counted in moves of the winning player
+      }
+      else if (bestRank == -1){
+        cout << "Forced loss in " << (bestDepth + 1) / 2 << endl;
+      }
+      cout << "Estimated number of wins: " << this->wi << endl;
+      cout << "Probability of winning: " << static_cast<double>(this->wi) / static_cast<double>(max(this->ni, 1)) << endl;
+      return bestMove;
+    }
+
+    // Chooses a move with the default SearchSettings
+    int makeMove(){
+      return this->makeMove(SearchSettings());
+    }
+
+    // Chooses a move with settings.iterations playouts
+    int makeMove(const SearchSettings& settings){
+      return this->makeMove(settings, SearchLimits::playouts(settings.iterations));
+    }
+
+    // Chooses the best move found before the deadline
+    int makeMove(chrono::steady_clock::time_point deadline){
+      return this->makeMove(SearchSettings(), SearchLimits::until(deadline));
+    }
+
+    // Chooses the best move found before a limit (see SearchLimits::playouts(), SearchLimits::nodes() and SearchLimits::until()) is reached
+    int makeMove(const SearchLimits& limits){
+      return this->makeMove(SearchSettings(), limits);
+    }
+
+    // Plays through sample games for each possible move
+    int makeMove(const SearchSettings& settings, const SearchLimits& limits){
+      /*
+      1. Check if a move is possible in each column
+      2. Search the moves (UCT over the DAG of positions, or a Lightweight Playthrough of each child Node), on settings.threads threads
+      3. Return the column of the best move
+      */
+
+      // Solved positions near the start of the game come from the opening book
+      if (settings.book != nullptr){
+        int score;
+        int col = settings.book->lookup(this->bitboard(), score);
+        if (col != -1){
+          if (settings.verbose){
+            cout << "Book move (score " << score << ")" << endl;
+          }
+          return col;
+        }
+      }
+
+      // Positions with few empty cells left come from the tablebase
+      if (settings.tablebase != nullptr){
+        int value;
+        int col = settings.tablebase->bestMove(this->bitboard(), value);
+        if (col != -1){
+          if (settings.verbose){
+            cout << "Tablebase move (" << (value > 0 ? "win" : (value < 0 ? "loss" : "draw")) << ")" << endl;
+          }
+          return col;
+        }
+      }
+
+      array<array<int, 7>, 6> emptyBoard;  // For comparison purposes
+      for (int i = 0; i < emptyBoard.size(); i++){
+        for (int j = 0; j < emptyBoard[i].size(); j++){
+          emptyBoard[i][j] = -1;
+        }
+      }
+
+      // Without a book: if board is empty (this is first move), go middle column (proven to be the best choice)
+      if (this->tileSpaces == emptyBoard){
+        return 3;
+      }
+
+      if (this->movesLeft() <= settings.solverEmpties){    // Few enough cells left to play perfectly
+        SearchLimits solverLimits;     // Playouts and nodes limit the search: the solver gets half of the time left and the stop flag
+        if (limits.useDeadline && !settings.deterministic){   // A deterministic solve always finishes, like searchDeterministic()
+          chrono::steady_clock::time_point now = chrono::steady_clock::now();
+          solverLimits = SearchLimits::until(now + (limits.deadline - now) / 2);
+        }
+        solverLimits.stopFlag = settings.deterministic ? nullptr : limits.stopFlag;
+        int solvedMove = this->solveMove(settings, solverLimits);
+        if (solvedMove != -1){
+          return solvedMove;
+        }
+        // Not solved in time: search with what is left of the limits
+      }
+      if (settings.deterministic){
+        return this->chooseMove(this->searchDeterministic(settings, limits), settings);
+      }
+      unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();   // Use the current time to seed the psuedo-random number generator
+      if (settings.processes != nullptr){
+        return this->chooseMove(this->searchRootProcesses(*settings.processes, settings, limits, seed), settings);
+      }
+      if (settings.useSharedTree){
+        SharedTreeCounters counters;
+        RootStatistics stats = this->searchSharedTree(settings, limits, seed, counters);
+        if (settings.verbose){
+          cout << "Shared tree: " << counters.nodes << " nodes, " << counters.expansionCollisions << " expansion collisions, " << counters.virtualLossHits << " virtual loss hits" << endl;
+        }
+        return this->chooseMove(stats, settings);
+      }
+      if (settings.pool != nullptr && !settings.useTranspositions && !settings.useSequentialHalving){
+        return this->chooseMove(this->sampleFlatParallel(settings, limits, seed), settings);
+      }
+      if (settings.sharedTable != nullptr && settings.useTranspositions && !settings.pondered){
+        settings.sharedTable->newSearch();
+      }
+      if (settings.threads > 1){
+        RootStatistics stats = this->searchRootParallel(settings, limits, seed);
+        if (settings.sharedTable != nullptr && settings.useTranspositions && settings.verbose){
+          cout << "Shared table: hit rate " << settings.sharedTable->hitRate() << ", collision rate " << settings.sharedTable->collisionRate() << ", fill " << settings.sharedTable->fill() << endl;
+        }
+        return this->chooseMove(stats, settings);
+      }
+
+      // Use the table from settings (kept between moves) or a temporary one
+      TranspositionTable *table = settings.table;
+      unique_ptr<TranspositionTable> localTable;
+      if (table == nullptr && settings.useTranspositions && settings.sharedTable == nullptr){
+        localTable.reset(new TranspositionTable(settings.tableSizeMB));
+        table = localTable.get();
+      }
+      c4Generator generator (seed);
+      return this->chooseMove(this->searchRoot(settings, limits, table, generator), settings);
+    }
+};
+
+class Ponderer {
+  /*
+  Searches on a background thread while the opponent is thinking. The statistics go into the game's table
+  (settings.sharedTable if set, else settings.table), so when makeMove() is called after the opponent's move, the subtree
+  that was searched while pondering is already there.
+  The table must not be used by anything else until stop() returns.
+  */
+  public:
+    Ponderer(const SearchSettings& settings){
+      this->settings = settings;
+      this->settings.useSequentialHalving = false;
+      this->quit = false;
+      this->interrupt = false;
+      this->running = false;
+      this->playouts = 0;
+    }
+
+    ~Ponderer(){
+      this->stop();
+    }
+
+    // Starts searching position (the opponent is to move), as a new search of the table
+    void start(const Node& position){
+      this->stop();
+      if (this->settings.sharedTable != nullptr){
+        this->settings.sharedTable->newSearch();
+      }
+      else if (this->settings.table != nullptr){
+        this->settings.table->newSearch();
+      }
+      this->root = position;
+      this->quit = false;
+      this->interrupt = false;
+      this->playouts = 0;
+      this->running = true;
+      this->worker = thread(&Ponderer::ponderLoop, this);
+    }
+
+    // The opponent played colNum: keep searching from the position it leads to
+    void opponentMoved(int colNum){
+      if (!this->running){
+        return;
+      }
+      {
+        lock_guard<mutex> guard(this->rootLock);
+        Node current = this->root;
+        this->root = current.getChildNode(colNum);
+        this->interrupt = true;   // Restarts the search at the new root within one playout
+      }
+      this->wakeUp.notify_one();
+    }
+
+    // Stops pondering (within one playout), returns the number of playouts searched
+    long long stop(){
+      if (this->running){
+        {
+          lock_guard<mutex> guard(this->rootLock);
+          this->quit = true;
+          this->interrupt = true;
+        }
+        this->wakeUp.notify_one();
+        this->worker.join();
+        this->running = false;
+      }
+      return this->playouts;
+    }
+
+    // Was position the last one searched, so a search of it can continue the table's current search (SearchSettings::pondered)?
+    bool pondered(const Node& position){
+      lock_guard<mutex> guard(this->rootLock);
+      return this->playouts > 0 && this->root.hashKey == position.hashKey;
+    }
+
+  private:
+    SearchSettings settings;
+    thread worker;
+    mutex rootLock;
+    condition_variable wakeUp;    // Notified when the root changes or pondering stops
+    Node root;                    // Position being searched (protected by rootLock)
+    atomic<bool> quit;
+    atomic<bool> interrupt;       // Stops the current search (to quit or to move to a new root)
+    bool running;
+    atomic<long long> playouts;
+
+    void ponderLoop(){
+      unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();   // Use the current time to seed the psuedo-random number generator
+      c4Generator generator (seed);
+      SearchLimits limits;
+      limits.stopFlag = &this->interrupt;
+
+      while (true){
+        Node current;
+        {
+          lock_guard<mutex> guard(this->rootLock);
+          if (this->quit){
+            return;
+          }
+          current = this->root;
+          this->interrupt = false;
+        }
+        if (current.getGameState() == -1){
+          if (this->settings.sharedTable != nullptr){
+            this->playouts += current.searchDAG(*this->settings.sharedTable, this->settings, limits, generator);
+          }
+          else if (this->settings.table != nullptr){
+            this->playouts += current.searchDAG(*this->settings.table, this->settings, limits, generator);
+          }
+        }
+
+        // The root was proven (or there is nothing to search): wait for a new root
+        unique_lock<mutex> guard(this->rootLock);
+        this->wakeUp.wait(guard, [this](){ return this->interrupt.load() || this->quit.load(); });
+      }
+    }
+};
+
+// Reads engine options from a comma separated list of key=value pairs (e.g. "playouts=2000,rave=1"), starting from base
+SearchSettings parseEngineSettings(const string& spec, SearchSettings base){
+  /*
+  Keys: playouts, c (exploration constant), table (MB), leafsolver (empty cells, -1 = from the budget), flat, solver, rave, halving, deterministic, sharedtree (0 or 1)
+  */
+  stringstream options(spec);
+  string option;
+  while (getline(options, option, ',')){
+    size_t equals = option.find('=');
+    if (equals == string::npos){
+      continue;
+    }
+    string key = option.substr(0, equals);
+    double value = atof(option.substr(equals + 1).c_str());
+    if (key == "playouts"){
+      base.iterations = static_cast<int>(value);
+    }
+    else if (key == "c"){
+      base.explorationConstant = value;
+    }
+    else if (key == "table"){
+      base.tableSizeMB = static_cast<int>(value);
+    }
+    else if (key == "flat"){
+      base.useTranspositions = (value == 0);
+    }
+    else if (key == "solver"){
+      base.useSolver = (value != 0);
+    }
+    else if (key == "rave"){
+      base.useRave = (value != 0);
+    }
+    else if (key == "halving"){
+      base.useSequentialHalving = (value != 0);
+    }
+    else if (key == "deterministic"){
+      base.deterministic = (value != 0);
+    }
+    else if (key == "sharedtree"){
+      base.useSharedTree = (value != 0);
+    }
+    else if (key == "leafsolver"){
+      base.leafSolverEmpties = static_cast<int>(value);
+    }
+    else{
+      cerr << "Unknown engine option: " << key << endl;
+    }
+  }
+  return base;
+}
+
+// Options for --selfplay
+class SelfPlayOptions {
+  public:
+    int games;            // Number of games to play
+    int threads;          // Games played at once
+    int openingPlies;     // Random moves played before the engines take over
+    unsigned seed;        // Seed for the random openings (game i uses seed + i)
+    string outputFile;    // One line per game: "<game> <R|Y|D> <columns played>"
+    SearchSettings red;   // Engine settings for each side
+    SearchSettings yellow;
+
+    SelfPlayOptions(){
+      this->games = 100;
+      this->threads = max(1U, thread::hardware_concurrency());
+      this->openingPlies = 2;
+      this->seed = 1;
+      this->outputFile = "selfplay.txt";
+      this->red.iterations = 1000;
+      this->red.tableSizeMB = 4;
+      this->red.verbose = false;
+      this->yellow = this->red;
+    }
+};
+
+// Plays one engine vs engine game, returns the final getGameState() value and appends the columns played to moveList
+int playSelfPlayGame(const SelfPlayOptions& options, int gameNumber, string& moveList){
+  c4Generator openingGenerator (options.seed + gameNumber);
+  TranspositionTable redTable(options.red.tableSizeMB);       // Each side keeps its own table for the whole game
+  TranspositionTable yellowTable(options.yellow.tableSizeMB);
+  SearchSettings red = options.red;
+  SearchSettings yellow = options.yellow;
+  red.table = &redTable;
+  yellow.table = &yellowTable;
+  red.seed = options.seed + gameNumber;     // Only used by deterministic engines
+  yellow.seed = ~(options.seed + gameNumber);
+
+  Node position;
+  int results = position.getGameState();
+  while (results == -1){
+    int col;
+    if (static_cast<int>(moveList.size()) < options.openingPlies){    // Random opening
+      do {
+        col = openingGenerator() % 7;
+      } while (!position.isPossible(col));
+    }
+    else{
+      col = position.makeMove(position.nextPlayer() == 1 ? red : yellow);
+    }
+    moveList += static_cast<char>('0' + col);
+    Node previous = position;
+    position = previous.getChildNode(col);
+    results = position.getGameState();
+  }
+  return results;
+}
+
+// Plays options.games games at once on a WorkStealingPool and writes the results as they finish
+void runSelfPlay(const SelfPlayOptions& options){
+  ofstream output(options.outputFile);
+  if (!output){
+    cerr << "Could not open " << options.outputFile << endl;
+    return;
+  }
+
+  WorkStealingPool pool(options.threads);
+  TaskGroup group;
+  mutex outputLock;
+  array<int, 4> wins = {0, 0, 0, 0};    // Indexed by getGameState() result (1 = Red, 2 = Yellow, 3 = draw)
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+  for (int game = 0; game < options.games; game++){
+    pool.submit(group, [&, game](){
+      string moveList;
+      int results = playSelfPlayGame(options, game, moveList);
+      lock_guard<mutex> guard(outputLock);
+      output << game << " " << "?RYD"[results] << " " << moveList << "\n";
+      wins[results] ++;
+    });
+  }
+  pool.wait(group);
+
+  double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  cout << "Played " << options.games << " games in " << seconds << " s (" << options.games / max(seconds, 1e-9) * 3600 << " games/hour)" << endl;
+  cout << "Red: " << wins[1] << ", Yellow: " << wins[2] << ", Draws: " << wins[3] << endl;
+  cout << "Pool: " << pool.steals << " steals, " << pool.idleMicroseconds / 1000 << " ms idle" << endl;
+}
+
+// Prints shared tree playouts per second for 1 to maxThreads threads, with and without sharded counters
+void runScalingBenchmark(int maxThreads, int milliseconds, ostream& output){
+  Node root;
+  root.playMoves("33");   // Past the opening book move, so makeMove() would search it too
+  output << "threads  unsharded playouts/s  sharded playouts/s  speedup" << endl;
+  for (int threads = 1; threads <= maxThreads; threads = (threads < maxThreads && threads * 2 > maxThreads) ? maxThreads : threads * 2){
+    array<double, 2> rates;
+    for (int sharded = 0; sharded < 2; sharded++){
+      SearchSettings settings;
+      settings.threads = threads;
+      settings.useSharedTree = true;
+      settings.shardDepth = sharded ? SearchSettings().shardDepth : 0;
+      SharedTreeCounters counters;
+      chrono::steady_clock::time_point start = chrono::steady_clock::now();
+      RootStatistics stats = root.searchSharedTree(settings, SearchLimits::until(start + chrono::milliseconds(milliseconds)), threads, counters);
+      rates[sharded] = stats.playouts / chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+    output << setw(7) << threads << setw(22) << static_cast<long long>(rates[0]) << setw(20) << static_cast<long long>(rates[1])
+           << setw(9) << fixed << setprecision(2) << rates[1] / max(rates[0], 1.0) << endl;
+  }
+}
+
+// Prints the exact score of a position and of each move (--solve), or only win (1), draw (0) or loss (-1) if weak (--weak)
+void runSolve(const BitboardPosition& position, int tableSizeMB, bool weak, ostream& output){
+  SolverTable table(tableSizeMB);
+  Solver solver(&table);
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  int score = solver.solve(position, weak);
+  array<int, 7> scores = solver.analyze(position, weak);
+  double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+  string result = score > 0 ? "win" : (score < 0 ? "loss" : "draw");
+  output << "Score: " << score << " (" << result;
+  if (score != 0 && !weak){
+    output << " in " << Solver::movesToEnd(position, score) << " moves";
+  }
+  output << " for the player to move)" << endl << "Moves:";
+  for (int col = 0; col < 7; col++){
+    if (scores[col] == Solver::INVALID_MOVE){
+      output << " -";
+    }
+    else{
+      output << " " << scores[col];
+    }
+  }
+  output << endl << "Positions: " << solver.nodeCount << " in " << seconds << " s" << endl;
+  output << "Table: " << table.numEntries << " entries, " << table.hits << " hits, " << table.misses << " misses, " << table.stores << " stores" << endl;
+}
+
+// perft() on the bitboard kernel
+long long perftBitboard(const BitboardPosition& position, int depth){
+  if (depth == 0){
+    return 1;
+  }
+  long long count = 0;
+  for (int col = 0; col < BitboardPosition::WIDTH; col++){
+    if (!position.canPlay(col)){
+      continue;
+    }
+    if (position.isWinningMove(col) || position.moves + 1 == BitboardPosition::WIDTH * BitboardPosition::HEIGHT){
+      count += (depth == 1);    // The game ends with this move
+      continue;
+    }
+    BitboardPosition child = position;
+    child.play(col);
+    count += perftBitboard(child, depth - 1);
+  }
+  return count;
+}
+
+// perft() (or perftBitboard()) with the subtrees after the first two moves run as pool tasks
+long long perftParallel(const Node& root, int depth, bool bitboard, WorkStealingPool& pool){
+  const int splitDepth = min(depth, 2);
+  vector<Node> frontier = {root};
+  for (int ply = 0; ply < splitDepth; ply++){
+    vector<Node> next;
+    for (Node& position : frontier){
+      if (position.getGameState() != -1){
+        continue;   // Sequences that end here are shorter than depth
+      }
+      for (int col = 0; col < 7; col++){
+        if (position.isPossible(col)){
+          Node parent = position;
+          next.push_back(parent.getChildNode(col));
+        }
+      }
+    }
+    frontier.swap(next);
+  }
+
+  atomic<long long> total (0);
+  TaskGroup group;
+  for (const Node& position : frontier){
+    pool.submit(group, [&total, position, depth, splitDepth, bitboard](){
+      Node start = position;
+      long long count;
+      if (depth == splitDepth){
+        count = 1;
+      }
+      else if (start.getGameState() != -1){
+        count = 0;
+      }
+      else{
+        count = bitboard ? perftBitboard(start.bitboard(), depth - splitDepth) : start.perft(depth - splitDepth);
+      }
+      total += count;
+    });
+  }
+  pool.wait(group);
+  return total;
+}
+
+// Number of different positions after each number of moves from root up to depth (games that are over aren't continued)
+vector<long long> uniquePositions(const BitboardPosition& root, int depth, WorkStealingPool& pool){
+  /*
+  Each layer is expanded in pool tasks, then sorted by key and duplicates (transpositions) removed
+  */
+  vector<long long> counts = {1};
+  vector<BitboardPosition> layer = {root};
+  vector<bool> over = {false};    // The last move ended the game
+  for (int ply = 1; ply <= depth; ply++){
+    const size_t chunk = 4096;
+    vector<vector<pair<BitboardPosition, bool>>> parts((layer.size() + chunk - 1) / chunk);
+    TaskGroup group;
+    for (size_t part = 0; part < parts.size(); part++){
+      pool.submit(group, [&, part](){
+        for (size_t i = part * chunk; i < min(layer.size(), (part + 1) * chunk); i++){
+          if (over[i]){
+            continue;
+          }
+          for (int col = 0; col < BitboardPosition::WIDTH; col++){
+            if (layer[i].canPlay(col)){
+              BitboardPosition child = layer[i];
+              bool ends = child.isWinningMove(col);
+              child.play(col);
+              parts[part].push_back(make_pair(child, ends || child.moves == BitboardPosition::WIDTH * BitboardPosition::HEIGHT));
+            }
+          }
+        }
+      });
+    }
+    pool.wait(group);
+
+    vector<pair<BitboardPosition, bool>> next;
+    for (auto& part : parts){
+      next.insert(next.end(), part.begin(), part.end());
+    }
+    sort(next.begin(), next.end(), [](const pair<BitboardPosition, bool>& a, const pair<BitboardPosition, bool>& b){ return a.first.key() < b.first.key(); });
+    next.erase(unique(next.begin(), next.end(), [](const pair<BitboardPosition, bool>& a, const pair<BitboardPosition, bool>& b){ return a.first.key() == b.first.key(); }), next.end());
+
+    layer.clear();
+    over.clear();
+    for (auto& entry : next){
+      layer.push_back(entry.first);
+      over.push_back(entry.second);
+    }
+    counts.push_back(layer.size());
+  }
+  return counts;
+}
+
+// Prints perft counts and speed for each depth up to maxDepth on both kernels, and the unique positions if unique (--perft)
+void runPerft(const Node& root, int maxDepth, bool unique, int threads, ostream& output){
+  WorkStealingPool pool(threads);
+  output << "depth  sequences  Node kernel/s  bitboard kernel/s   (sequences per second)" << endl;
+  for (int depth = 1; depth <= maxDepth; depth++){
+    array<long long, 2> counts;
+    array<double, 2> seconds;
+    for (int bitboard = 0; bitboard < 2; bitboard++){
+      chrono::steady_clock::time_point start = chrono::steady_clock::now();
+      counts[bitboard] = perftParallel(root, depth, bitboard, pool);
+      seconds[bitboard] = max(chrono::duration<double>(chrono::steady_clock::now() - start).count(), 1e-9);
+    }
+    output << setw(5) << depth << setw(11) << counts[0] << setw(15) << static_cast<long long>(counts[0] / seconds[0])
+           << setw(18) << static_cast<long long>(counts[1] / seconds[1]);
+    if (counts[0] != counts[1]){
+      output << "  (bitboard kernel counted " << counts[1] << ")";
+    }
+    output << endl;
+  }
+  if (unique){
+    Node position = root;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    vector<long long> counts = uniquePositions(position.bitboard(), maxDepth, pool);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    output << "Unique positions:";
+    for (long long count : counts){
+      output << " " << count;
+    }
+    output << " (" << seconds << " s)" << endl;
+  }
+}
+
+// Prints how long the Lazy SMP solver takes on position with 1 to maxThreads threads (--solvescaling)
+void runSolverScaling(const BitboardPosition& position, int maxThreads, int tableSizeMB, bool weak, ostream& output){
+  output << "threads  seconds  positions  speedup" << endl;
+  double single = 0;
+  for (int threads = 1; threads <= maxThreads; threads = (threads < maxThreads && threads * 2 > maxThreads) ? maxThreads : threads * 2){
+    SolverTable table(tableSizeMB);   // Every run starts from an empty table
+    long long nodes = 0;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    int score = Solver::solveParallel(position, weak, threads, &table, &nodes);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if (threads == 1){
+      single = seconds;
+    }
+    output << setw(7) << threads << setw(9) << fixed << setprecision(3) << seconds << setw(11) << nodes
+           << setw(9) << setprecision(2) << single / max(seconds, 1e-9) << "  (score " << score << ")" << endl;
+  }
+}
+
+// Queue with a fixed capacity: push() waits while it is full, pop() waits while it is empty
+template <class T>
+class BoundedQueue {
+  public:
+    BoundedQueue(size_t capacity){
+      this->capacity = max(capacity, size_t(1));
+      this->closed = false;
+    }
+
+    void push(T item){
+      unique_lock<mutex> guard(this->lock);
+      this->notFull.wait(guard, [this](){ return this->items.size() < this->capacity; });
+      this->items.push_back(move(item));
+      this->notEmpty.notify_one();
+    }
+
+    // Returns false once the queue is closed and empty
+    bool pop(T& item){
+      unique_lock<mutex> guard(this->lock);
+      this->notEmpty.wait(guard, [this](){ return !this->items.empty() || this->closed; });
+      if (this->items.empty()){
+        return false;
+      }
+      item = move(this->items.front());
+      this->items.pop_front();
+      this->notFull.notify_one();
+      return true;
+    }
+
+    // No more items will be pushed
+    void close(){
+      lock_guard<mutex> guard(this->lock);
+      this->closed = true;
+      this->notEmpty.notify_all();
+    }
+
+  private:
+    deque<T> items;
+    size_t capacity;
+    bool closed;
+    mutex lock;
+    condition_variable notEmpty;
+    condition_variable notFull;
+};
+
+// Options for --analyse
+class AnalysisOptions {
+  public:
+    int threads;              // Positions searched at once
+    int queueSize;            // Positions read ahead of the searches
+    SearchSettings settings;  // Search used for every position (settings.iterations playouts each)
+    unsigned seed;            // Position i is searched with seed + i
+
+    AnalysisOptions(){
+      this->threads = max(1U, thread::hardware_concurrency());
+      this->queueSize = 1024;
+      this->settings.tableSizeMB = 4;
+      this->settings.verbose = false;
+      this->seed = 1;
+    }
+};
+
+// Searches the position after moves, returns "<index> <moves> <best column> <probability of winning> <score of columns 0-6>"
+string analysePosition(long long index, const string& moves, const SearchSettings& settings, TranspositionTable* table, unsigned seed){
+  /*
+  The score of a column is the expected result ((wins + draws / 2) / playouts) for the player to move, 1 or 0 if proven and - if it can't be played.
+  Positions that can't be reached or are already over give "<index> <moves> invalid"
+  */
+  stringstream line;
+  line << index << " " << (moves.empty() ? "-" : moves) << " ";
+  Node position;
+  if (!position.playMoves(moves) || position.getGameState() != -1){
+    line << "invalid";
+    return line.str();
+  }
+
+  c4Generator generator (seed);
+  RootStatistics stats = position.searchRoot(settings, SearchLimits::playouts(settings.iterations), table, generator);
+  array<double, 7> scores;
+  for (int i = 0; i < 7; i++){
+    if (settings.useSolver && stats.provenValue[i] != 0){
+      scores[i] = stats.provenValue[i] == 1 ? 1.0 : 0.0;
+    }
+    else{
+      scores[i] = (stats.wi[i] + 0.5 * stats.di[i]) / max(stats.ni[i], 1LL);
+    }
+  }
+  int best = position.chooseMove(stats, settings);
+  line << best << " " << fixed << setprecision(3) << scores[best];   // Probability of winning with the chosen move
+  for (int i = 0; i < 7; i++){
+    if (position.isPossible(i)){
+      line << " " << scores[i];
+    }
+    else{
+      line << " -";
+    }
+  }
+  return line.str();
+}
+
+// Analyses every line of input (one position per line, as a list of columns, "-" for the empty board) in options.threads
+// tasks on options.settings.pool (or a pool of its own), writing results to output as they finish
+long long runAnalysis(istream& input, ostream& output, const AnalysisOptions& options){
+  BoundedQueue<pair<long long, string>> queue(options.queueSize);
+  mutex outputLock;
+  unique_ptr<WorkStealingPool> ownPool;
+  WorkStealingPool* pool = options.settings.pool;
+  if (pool == nullptr){
+    ownPool.reset(new WorkStealingPool(options.threads));
+    pool = ownPool.get();
+  }
+  TaskGroup workers;
+  for (int t = 0; t < options.threads; t++){
+    pool->submit(workers, [&](){
+      TranspositionTable table(options.settings.tableSizeMB);   // Cleared before every position, so each result only depends on its line
+      pair<long long, string> position;
+      while (queue.pop(position)){
+        table.clear();
+        string line = analysePosition(position.first, position.second, options.settings, &table, options.seed + position.first);
+        lock_guard<mutex> guard(outputLock);
+        output << line << "\n";
+      }
+    });
+  }
+
+  long long count = 0;
+  string line;
+  while (getline(input, line)){
+    line.erase(remove_if(line.begin(), line.end(), [](char c){ return isspace(static_cast<unsigned char>(c)); }), line.end());
+    if (line.empty() || line[0] == '#'){   // Blank line or comment
+      continue;
+    }
+    queue.push(make_pair(count++, line == "-" ? string() : line));   // Written as "-" by analysePosition()
+  }
+  queue.close();
+  pool->wait(workers);
+  output.flush();
+  return count;
+}
+
+// Main
+int main(int argc, char** argv) {
+  doctest::Context context(argc, argv);   // used for DocTest
+  int result = context.run();
+  if (context.shouldExit()){    // --exit only runs the test cases
+    return result;
+  }
+
+  // Command line options
+  bool humanPlayer = false;   // --human: the user plays Yellow
+  bool ponder = false;        // --ponder: search while the user is thinking
+  bool selfPlay = false;      // --selfplay <games>: engine vs engine games, no console game
+  SelfPlayOptions selfPlayOptions;
+  string analyseFile;         // --analyse <file or ->: analyse positions instead of playing
+  string outputFile;
+  AnalysisOptions analysisOptions;
+  int processes = 0;          // --processes <n>: search in n worker processes instead of threads
+  bool deterministic = false; // --deterministic: reproducible moves for a given --seed and --threads
+  bool sharedTree = false;    // --sharedtree: the --threads threads search one shared tree
+  int scalingMilliseconds = 0;  // --scaling <milliseconds>: shared tree benchmark for 1 to --threads threads
+  string solvePosition;         // --solve <columns played>: print the exact score of every move
+  bool solve = false;
+  int solverTableMB = SearchSettings().solverTableMB;   // --solvertable <MB>
+  bool weakSolve = false;       // --weak: --solve only tells wins, draws and losses apart
+  bool solveScaling = false;    // --solvescaling <columns played>: Lazy SMP solver speed for 1 to --threads threads
+  int perftDepth = -1;          // --perft <depth> [<columns played>]: count move sequences (and positions with --unique)
+  bool perftUnique = false;
+  string bookFile;              // --book <file>: opening book used by makeMove() (or written by --makebook)
+  int bookDepth = -1;           // --makebook <depth>: solve every position up to depth moves after --bookroot into --book (on --threads threads, resumes from <book>.checkpoint)
+  string bookRoot;              // --bookroot <columns played>: where the book starts (default the empty board)
+  string tablebaseFile;         // --tablebase <file>: endgame tablebase used by makeMove() and playouts (or written by --maketablebase)
+  int tablebaseEmpty = -1;      // --maketablebase <empty cells>: every position with at most this many empty cells below --tablebaseroot
+  string tablebaseRoot;         // --tablebaseroot <columns played>: where the tablebase starts (the empty board is far too large)
+  int tablebaseMemoryMB = 32;   // --tablebasememory <MB>: child ranks sorted in memory at once while building
+  int threads = max(1U, thread::hardware_concurrency());
+  for (int i = 1; i < argc; i++){
+    string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "--human"){
+      humanPlayer = true;
+    }
+    else if (arg == "--ponder"){
+      ponder = true;
+    }
+    else if (arg == "--selfplay" && hasValue){
+      selfPlay = true;
+      selfPlayOptions.games = atoi(argv[++i]);
+    }
+    else if (arg == "--threads" && hasValue){
+      selfPlayOptions.threads = max(1, atoi(argv[++i]));
+      analysisOptions.threads = selfPlayOptions.threads;
+      threads = selfPlayOptions.threads;
+    }
+    else if (arg == "--openings" && hasValue){   // Random plies at the start of each self-play game
+      selfPlayOptions.openingPlies = atoi(argv[++i]);
+    }
+    else if (arg == "--seed" && hasValue){
+      selfPlayOptions.seed = strtoul(argv[++i], nullptr, 10);
+      analysisOptions.seed = selfPlayOptions.seed;
+    }
+    else if (arg == "--output" && hasValue){
+      outputFile = argv[++i];
+    }
+    else if (arg == "--red" && hasValue){      // Engine options, see parseEngineSettings()
+      selfPlayOptions.red = parseEngineSettings(argv[++i], selfPlayOptions.red);
+    }
+    else if (arg == "--yellow" && hasValue){
+      selfPlayOptions.yellow = parseEngineSettings(argv[++i], selfPlayOptions.yellow);
+    }
+    else if (arg == "--analyse" && hasValue){
+      analyseFile = argv[++i];
+    }
+    else if (arg == "--engine" && hasValue){   // Engine options for --analyse
+      analysisOptions.settings = parseEngineSettings(argv[++i], analysisOptions.settings);
+    }
+    else if (arg == "--queue" && hasValue){
+      analysisOptions.queueSize = max(1, atoi(argv[++i]));
+    }
+    else if (arg == "--processes" && hasValue){
+      processes = max(0, atoi(argv[++i]));
+    }
+    else if (arg == "--deterministic"){
+      deterministic = true;
+    }
+    else if (arg == "--sharedtree"){
+      sharedTree = true;
+    }
+    else if (arg == "--scaling" && hasValue){
+      scalingMilliseconds = max(1, atoi(argv[++i]));
+    }
+    else if (arg == "--book" && hasValue){
+      bookFile = argv[++i];
+    }
+    else if (arg == "--makebook" && hasValue){
+      bookDepth = max(0, atoi(argv[++i]));
+    }
+    else if (arg == "--bookroot" && hasValue){
+      bookRoot = argv[++i];
+    }
+    else if (arg == "--tablebase" && hasValue){
+      tablebaseFile = argv[++i];
+    }
+    else if (arg == "--maketablebase" && hasValue){
+      tablebaseEmpty = max(1, atoi(argv[++i]));
+    }
+    else if (arg == "--tablebaseroot" && hasValue){
+      tablebaseRoot = argv[++i];
+    }
+    else if (arg == "--tablebasememory" && hasValue){
+      tablebaseMemoryMB = max(1, atoi(argv[++i]));
+    }
+    else if (arg == "--weak"){
+      weakSolve = true;
+    }
+    else if (arg == "--solvertable" && hasValue){
+      solverTableMB = max(1, atoi(argv[++i]));
+    }
+    else if (arg == "--perft" && hasValue){
+      perftDepth = max(0, atoi(argv[++i]));
+      if (i + 1 < argc && argv[i + 1][0] != '-'){
+        solvePosition = argv[++i];
       }
-
-      Node tmp;   // Creates default object (values are assigned later)
-      int results = tmp.getGameState();   // Store the results of the gameState check
-
-      // Do random Playthroughs numSearches number of times
-      for (int i = 0; i <= numSearches; i++){
-        tmp = *this;   // Give tmp the same starting paramters as current instance
-        while (results == -1){   // While the game is in progress
-          int colNum = generator()%7;   // Choose a random number between 0-6
-          if (tmp.isPossible(colNum)){    // Check if that move is possible
-              tmp = tmp.getChildNode(colNum);   // Update tmp to be new state
-              results = tmp.getGameState();
-          }
-        }
-
-        // Check new game state and increment accumulators as needed
-        this->ni ++;    // A new possible endgame has been found
-        if (results == 1 && tmp.playerJustMoved == 1) {     // Red wins!
-          this->wi ++;  // A winning move has been found
-        }
-
-        else if (results == 2 && tmp.playerJustMoved == 2){   // Yellow wins!
-            this->wi ++;  // A winning move has been found
-          }
-        else if (results == 3) {
-          this->di ++;  // final state of this path was a draw
-        }
+    }
+    else if (arg == "--unique"){
+      perftUnique = true;
+    }
+    else if (arg == "--solvescaling"){
+      solveScaling = true;
+      if (hasValue && argv[i + 1][0] != '-'){
+        solvePosition = argv[++i];
       }
-      // // For test purposes
-      // cout << "Nodes searched: " << this->ni << endl;
-      // cout << "Probability of winning: " << this->wi / this->ni << endl;
-      // cout << "Number of winning Nodes: " << this->wi << endl;
-      return;
     }
-
-    // Plays through a sample game for each possible move
-    int makeMove(){
-      /*
-      1. Check if a move is possible in each column
-      2. If a move is possible, create a child Node for that move
-      3. Do a Lightweight Playthrough of the child Node
-      4. Return the number of the child Node with the best move
-      */
-
-      array<array<int, 7>, 6> emptyBoard;  // For comparison purposes
-      for (int i = 0; i < emptyBoard.size(); i++){
-        for (int j = 0; j < emptyBoard[i].size(); j++){
-          emptyBoard[i][j] = -1;
-        }
+    else if (arg == "--solve"){
+      solve = true;
+      if (hasValue && argv[i + 1][0] != '-'){   // No moves = the empty board
+        solvePosition = argv[++i];
       }
+    }
+  }
 
-      // If board is empty (this is first move), go middle column (proven to be the best choice)
-      if (this->tileSpaces == emptyBoard){
-        return 3;
+  if (scalingMilliseconds > 0){
+    runScalingBenchmark(threads, scalingMilliseconds, cout);
+    return result;
+  }
+  if (bookDepth >= 0){
+    Node root;
+    if (bookFile.empty() || !root.playMoves(bookRoot) || root.getGameState() != -1){
+      cerr << "--makebook needs --book <file> and a valid --bookroot" << endl;
+      return 1;
+    }
+    vector<uint64_t> entries = OpeningBook::build(root.bitboard(), bookDepth, solverTableMB, weakSolve, threads, bookFile + ".checkpoint", &cerr);
+    if (!OpeningBook::write(bookFile, entries)){
+      cerr << "Could not write " << bookFile << endl;
+      return 1;
+    }
+    cout << "Wrote " << entries.size() << " positions to " << bookFile << endl;
+    return result;
+  }
+  if (tablebaseEmpty >= 0){
+    Node root;
+    if (tablebaseFile.empty() || !root.playMoves(tablebaseRoot) || root.getGameState() != -1){
+      cerr << "--maketablebase needs --tablebase <file> and a valid --tablebaseroot" << endl;
+      return 1;
+    }
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    size_t ranksPerRun = static_cast<size_t>(tablebaseMemoryMB) << 20 >> 3;
+    Tablebase tablebase;
+    if (!Tablebase::build(root.bitboard(), tablebaseEmpty, tablebaseFile, ranksPerRun, &cerr) || !tablebase.open(tablebaseFile)){
+      cerr << "Could not build " << tablebaseFile << endl;
+      return 1;
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << "Wrote " << tablebase.size() << " positions to " << tablebaseFile << " in " << seconds << " s" << endl;
+    return result;
+  }
+  if (perftDepth >= 0){
+    Node position;
+    if (!position.playMoves(solvePosition)){
+      cerr << "Invalid position: " << solvePosition << endl;
+      return 1;
+    }
+    runPerft(position, perftDepth, perftUnique, threads, cout);
+    return result;
+  }
+  if (solve || solveScaling){
+    Node position;
+    if (!position.playMoves(solvePosition) || position.getGameState() != -1){
+      cerr << "Invalid position: " << solvePosition << endl;
+      return 1;
+    }
+    if (solveScaling){
+      runSolverScaling(position.bitboard(), threads, solverTableMB, weakSolve, cout);
+    }
+    else{
+      runSolve(position.bitboard(), solverTableMB, weakSolve, cout);
+    }
+    return result;
+  }
+  if (selfPlay){
+    if (!outputFile.empty()){
+      selfPlayOptions.outputFile = outputFile;
+    }
+    runSelfPlay(selfPlayOptions);
+    return result;
+  }
+  if (!analyseFile.empty()){
+    ifstream inputFile;
+    ofstream analysisFile;
+    if (analyseFile != "-"){
+      inputFile.open(analyseFile);
+      if (!inputFile){
+        cerr << "Could not open " << analyseFile << endl;
+        return 1;
       }
-
-      // For all other moves
-      else{
-        vector<Node> childrenNodes;   // Create a list to keep track of each child Node
-        Node placeholder;   // Default state for Node (used as placeholder in vectors and stuff)
-
-        // Generate childrenNodes for all possible moves
-        for (int i = 0; i < 7; i++){   // For each column
-          if (this->isPossible(i)){    // Check if a move is possble
-            Node tmp;   // Create a temporary Node obeject
-            tmp = *this;    // Give tmp the same starting paramters as current instance
-            tmp = tmp.getChildNode(i);   // Convert tmp into a child node
-            childrenNodes.push_back(tmp);   // Append tmp to the list of child nodes
-
-            // Sample child Node
-            childrenNodes[i].sampleNodePath(50);    // Updates wi for each node
-
-            // Update root node's accumulators
-            this->ni += childrenNodes[i].ni;
-            this->wi += childrenNodes[i].wi;
-            this->di += childrenNodes[i].di;
-          }
-          else{
-            childrenNodes.push_back(placeholder);  // If a move wasn't possible, give it a placeholder value since index of node is column of move
-          }
-        }
-
-        // Find the best move based on Node sampling
-        Node bestNode;  // Used to keep track of which child Node produced the best results
-        int bestMove;   // Used to keep track of which column is the best move
-
-        // Set bestNode and bestMove to first possible move from list
-        for (int i = 0; i < childrenNodes.size(); i++){
-          // cout << "childrenNodes[i] != placeholder: " << (childrenNodes[i] != placeholder) << endl;   // For test purposes
-          if (this->isPossible(i) && childrenNodes[i] != placeholder){   // If child Node is both possible and not a placeholder
-            bestNode = childrenNodes[i];
-            bestMove = i;
-          }
-        }
-
-        // See if a better move is possible
-        for (int i = 0; i < childrenNodes.size(); i++){
-          if (childrenNodes[i].wi > bestNode.wi){
-            bestNode = childrenNodes[i];
-            bestMove = i;
-          }
-        }
-
-        cout << "Estimated number of wins: " << this->wi << endl;
-        cout << "Probability of winning: " << static_cast<double>(this->wi) / static_cast<double>(this->ni) << endl;
-        return bestMove;    // If the recommended is possible, make it
     }
+    if (!outputFile.empty()){
+      analysisFile.open(outputFile);
+    }
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    long long positions = runAnalysis(analyseFile == "-" ? cin : inputFile, outputFile.empty() ? cout : analysisFile, analysisOptions);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cerr << "Analysed " << positions << " positions in " << seconds << " s" << endl;
+    return result;
   }
-};
-
-// Main
-int main() {
-  int result = (new doctest::Context())->run();     // used for DocTest
 
   ofstream usefulNodes;   // Create a filestream to read and write nodes from/to
   usefulNodes.open("nodes.txt");    // Open the file (open and closed in main, but used by MCTS)
 
+  SearchSettings settings;    // MCTS options
+  unique_ptr<ProcessWorkers> processWorkers;
+  if (processes > 0){   // Forked before any thread is started
+    SearchSettings workerSettings = settings;
+    workerSettings.verbose = false;
+    processWorkers.reset(new ProcessWorkers(processes, [workerSettings](const string& request){
+      static TranspositionTable table(workerSettings.tableSizeMB);    // Created in the worker, kept between moves
+      return Node::answerSearchRequest(request, workerSettings, &table);
+    }));
+    settings.processes = processWorkers.get();
+  }
+  settings.threads = threads;   // Root parallel search on every core
+  settings.solverTableMB = solverTableMB;
+  OpeningBook book;
+  if (!bookFile.empty()){
+    if (book.open(bookFile)){
+      settings.book = &book;
+    }
+    else{
+      cerr << "Could not open the opening book " << bookFile << endl;
+    }
+  }
+  Tablebase tablebase;
+  if (!tablebaseFile.empty()){
+    if (tablebase.open(tablebaseFile)){
+      settings.tablebase = &tablebase;
+    }
+    else{
+      cerr << "Could not open the tablebase " << tablebaseFile << endl;
+    }
+  }
+  settings.deterministic = deterministic;
+  settings.seed = selfPlayOptions.seed;
+  settings.useSharedTree = sharedTree;
+  if (deterministic){
+    ponder = false;   // Pondering fills the game's table depending on how long the user takes
+  }
+  if (sharedTree){
+    ponder = false;   // The shared tree doesn't use the game's table, which is what pondering fills
+  }
+  WorkStealingPool pool(settings.threads);    // Keeps the search threads between moves
+  settings.pool = &pool;
+  unique_ptr<LocklessTranspositionTable> sharedTable;
+  if (settings.threads > 1){    // Threads share what they learn about positions
+    sharedTable.reset(new LocklessTranspositionTable(64));
+    settings.sharedTable = sharedTable.get();
+  }
+  TranspositionTable gameTable(settings.tableSizeMB);   // Positions searched on earlier moves are reused on later moves
+  settings.table = &gameTable;
+  Ponderer ponderer(settings);
+
   bool keepPlaying = true;  // Used to play again
 
   while(keepPlaying){       // Allows the player to play multiple times
@@ -690,16 +4833,37 @@ int main() {
         cout << "Yellow's Turn" << endl;
       }
 
-      // MCTS is implemented here
       Node currentNode(currentBoard);   // Create a new node tree with currentBoard as root
-      int AIChoice = currentNode.makeMove();
-      cout << "Selected move: " << AIChoice << endl;
-      currentBoard = currentBoard.dropToken(AIChoice);        // Gives MCTS control of board
 
-      // // This block of code gives the user control of board
-      // cout << "Select a Column Number in which to drop your token: ";
-      // cin >> playerChoice;  // Change this line for MCTS input (or make conditional for PvC)
-      // currentBoard = currentBoard.dropToken(playerChoice);          // Create a new board based on player's choice
+      // This block of code gives the user control of board
+      if (humanPlayer && currentBoard.playerJustMoved == 1){
+        if (ponder){
+          ponderer.start(currentNode);    // Think on the user's time
+        }
+        int playerChoice = -1;
+        while (playerChoice < 0 || playerChoice > 6 || !currentNode.isPossible(playerChoice)){
+          cout << "Select a Column Number in which to drop your token: ";
+          if (!(cin >> playerChoice)){
+            ponderer.stop();
+            return result;
+          }
+        }
+        ponderer.opponentMoved(playerChoice);   // Keep pondering on the position the user chose
+        currentBoard = currentBoard.dropToken(playerChoice);          // Create a new board based on player's choice
+      }
+
+      // MCTS is implemented here
+      else{
+        long long ponderPlayouts = ponderer.stop();
+        SearchSettings moveSettings = settings;
+        if (ponderPlayouts > 0){
+          cout << "Pondered playouts: " << ponderPlayouts << endl;
+          moveSettings.pondered = ponderer.pondered(currentNode);   // Keep the entries written while pondering
+        }
+        int AIChoice = currentNode.makeMove(moveSettings);
+        cout << "Selected move: " << AIChoice << endl;
+        currentBoard = currentBoard.dropToken(AIChoice);        // Gives MCTS control of board
+      }
 
       cout << "Current Board: " << endl << currentBoard;
       playingGame = currentBoard.continuePlaying();    // continuePlaying() returns false if someone has won
@@ -717,8 +4881,11 @@ int main() {
     }
 
     // Modify this bit to change repeat functionality
+    ponderer.stop();
     cout << "Play Again? Y/n: ";
-    cin >> playAgain;
+    if (!(cin >> playAgain)){
+      break;
+    }
 
     if (playAgain == 'y' || playAgain == 'Y'){
       keepPlaying = true;
@@ -746,3 +4913,927 @@ TEST_CASE("c4Board Class Tests") {
 // TEST_CASE("Test Playthrough") {
 //   CHECK()
 // }
+
+TEST_CASE("Transposition Table Tests") {
+  Node root;
+  Node first = root.getChildNode(0).getChildNode(1).getChildNode(2);    // Same position reached by two move orders
+  Node second = root.getChildNode(2).getChildNode(1).getChildNode(0);
+  CHECK(first.hashKey == second.hashKey);
+  CHECK(first.hashKey == positionHash(first.tileSpaces));
+  CHECK(first.hashKey != root.getChildNode(0).getChildNode(2).getChildNode(1).hashKey);
+
+  TranspositionTable table(1);
+  CHECK(table.lookup(first.hashKey) == nullptr);
+  table.insert(first.hashKey)->ni = 5;
+  CHECK(table.lookup(second.hashKey)->ni == 5);   // Shared by both paths
+}
+
+TEST_CASE("DAG Search Tests") {
+  Node testNode;
+  int moves[] = {0, 1, 0, 1, 0, 1};   // Red and Yellow both have three in a column, Red to move
+  for (int col : moves){
+    testNode = testNode.getChildNode(col);
+  }
+  SearchSettings settings;
+  settings.iterations = 2000;
+  settings.tableSizeMB = 1;
+  CHECK(testNode.makeMove(settings) == 0);
+}
+
+TEST_CASE("MCTS-Solver Tests") {
+  SearchSettings settings;
+  settings.iterations = 5000;
+  c4Generator generator(1);
+
+  // Red to move can win immediately in column 0: the root is a proven loss for Yellow
+  Node winInOne;
+  int movesWinInOne[] = {0, 1, 0, 1, 0, 1};
+  for (int col : movesWinInOne){
+    winInOne = winInOne.getChildNode(col);
+  }
+  TranspositionTable table(1);
+  winInOne.searchDAG(table, settings, generator);
+  REQUIRE(table.lookup(winInOne.hashKey) != nullptr);
+  CHECK(table.lookup(winInOne.hashKey)->isProven);
+  CHECK(table.lookup(winInOne.hashKey)->provenValue == -1);
+  CHECK(table.lookup(winInOne.hashKey)->provenDepth == 1);
+
+  // Red to move wins in two by making an open three on the bottom row (column 3)
+  Node winInTwo;
+  int movesWinInTwo[] = {1, 1, 2, 2};
+  for (int col : movesWinInTwo){
+    winInTwo = winInTwo.getChildNode(col);
+  }
+  TranspositionTable secondTable(1);
+  settings.table = &secondTable;
+  CHECK(winInTwo.makeMove(settings) == 3);
+  CHECK(secondTable.lookup(winInTwo.childHash(3))->isProven);
+  CHECK(secondTable.lookup(winInTwo.childHash(3))->provenDepth == 2);
+
+  // Leaves with few empty cells are solved instead of played out: the children of a position with 16 empty cells
+  // are proven as soon as they are expanded (until one wins), with the values and distances the solver finds
+  CHECK(Node::leafSolverThreshold(settings, SearchLimits::playouts(10000)) == 13);
+  CHECK(Node::leafSolverThreshold(settings, SearchLimits::playouts(100000000)) == 20);
+  Node endgame;
+  REQUIRE(endgame.playMoves("03342253235425350210504405"));
+  settings.table = nullptr;
+  settings.leafSolverEmpties = 15;
+  TranspositionTable hybridTable(1);
+  endgame.searchDAG(hybridTable, settings, SearchLimits::playouts(7), generator);
+  Solver solver;
+  BitboardPosition position = endgame.bitboard();
+  array<int, 7> scores = solver.analyze(position);
+  int expanded = 0;
+  for (int col = 0; col < 7; col++){
+    TTEntry* child = hybridTable.lookup(endgame.childHash(col));
+    if (scores[col] == Solver::INVALID_MOVE || child == nullptr){
+      continue;
+    }
+    expanded ++;
+    CHECK(child->isProven);
+    CHECK(child->provenValue == (scores[col] > 0) - (scores[col] < 0));
+    if (scores[col] > 0){
+      CHECK((child->provenDepth + 2) / 2 == Solver::movesToEnd(position, scores[col]));
+    }
+  }
+  CHECK(expanded > 0);
+  CHECK(hybridTable.lookup(endgame.hashKey)->isProven);
+}
+
+TEST_CASE("RAVE Tests") {
+  Node testNode;
+  int moves[] = {0, 1, 0, 1, 0, 1};   // Red to move wins in column 0 (and must block column 1)
+  for (int col : moves){
+    testNode = testNode.getChildNode(col);
+  }
+  SearchSettings settings;
+  settings.iterations = 1000;
+  settings.useSolver = false;
+  settings.useRave = true;
+  TranspositionTable table(1);
+  settings.table = &table;
+  CHECK(testNode.makeMove(settings) == 0);
+
+  TTEntry* root = table.lookup(testNode.hashKey);
+  REQUIRE(root != nullptr);
+  CHECK(root->amafN[0] >= root->amafW[0]);
+  CHECK(root->amafN[0] >= table.lookup(testNode.childHash(0))->ni);   // Every playout through column 0 counts for it
+}
+
+TEST_CASE("Search Limits Tests") {
+  Node testNode;
+  int moves[] = {3, 3, 2, 4};
+  for (int col : moves){
+    testNode = testNode.getChildNode(col);
+  }
+  SearchSettings settings;
+  settings.useSolver = false;
+  TranspositionTable table(1);
+  c4Generator generator(1);
+
+  CHECK(testNode.searchDAG(table, settings, SearchLimits::playouts(123), generator) == 123);
+  CHECK(testNode.searchDAG(table, settings, SearchLimits::nodes(500), generator) < 500);
+
+  // The best move so far is returned once the deadline passes
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  int move = testNode.makeMove(settings, SearchLimits::until(start + chrono::milliseconds(50)));
+  CHECK(chrono::steady_clock::now() - start < chrono::milliseconds(500));
+  CHECK(testNode.isPossible(move));
+
+  settings.useTranspositions = false;   // Flat sampling stops at the same limits
+  start = chrono::steady_clock::now();
+  move = testNode.makeMove(settings, SearchLimits::until(start + chrono::milliseconds(50)));
+  CHECK(chrono::steady_clock::now() - start < chrono::milliseconds(500));
+  CHECK(testNode.isPossible(move));
+}
+
+TEST_CASE("Sequential Halving Tests") {
+  Node emptyNode;
+  array<long long, 7> sampled;
+  sampled.fill(0);
+  // With value(col) = col the highest column survives every round and gets the most playouts
+  int choice = emptyNode.sequentialHalving(700, [&](int col, long long n){ sampled[col] += n; }, [](int col){ return static_cast<double>(col); });
+  CHECK(choice == 6);
+  CHECK(sampled[0] == 700 / (7 * 3));
+  CHECK(sampled[6] > sampled[4]);    // The last two candidates share the final round
+  CHECK(sampled[0] + sampled[1] + sampled[2] + sampled[3] + sampled[4] + sampled[5] + sampled[6] <= 700);
+
+  // Once a limit is reached (nothing remains after the first round) no more rounds are run, the best candidate is chosen
+  sampled.fill(0);
+  int roundsRun = 0;
+  choice = emptyNode.sequentialHalving([&](){ return roundsRun++ == 0 ? 70LL : 0LL; }, [&](int col, long long n){ sampled[col] += n; }, [](int col){ return col == 2 ? 1.0 : 0.0; });
+  CHECK(choice == 2);
+  CHECK(sampled[2] == sampled[5]);
+  CHECK(roundsRun == 2);
+
+  Node testNode;
+  int moves[] = {0, 1, 0, 1, 0, 1};   // Red to move wins in column 0
+  for (int col : moves){
+    testNode = testNode.getChildNode(col);
+  }
+  SearchSettings settings;
+  settings.useSequentialHalving = true;
+  settings.iterations = 700;
+  settings.tableSizeMB = 1;
+  CHECK(testNode.makeMove(settings) == 0);
+  settings.useTranspositions = false;
+  CHECK(testNode.makeMove(settings) == 0);
+
+  // With only a deadline the rounds are sized from the time left, and the search ends near the deadline
+  settings.useTranspositions = true;
+  settings.useSolver = false;
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  CHECK(testNode.makeMove(settings, SearchLimits::until(start + chrono::milliseconds(200))) == 0);
+  CHECK(chrono::steady_clock::now() - start < chrono::milliseconds(1000));
+}
+
+TEST_CASE("Root Parallel Search Tests") {
+  Node testNode;
+  int moves[] = {0, 1, 0, 1, 0, 1};   // Red to move wins in column 0
+  for (int col : moves){
+    testNode = testNode.getChildNode(col);
+  }
+  SearchSettings settings;
+  settings.threads = 4;
+  settings.useSolver = false;
+  settings.tableSizeMB = 1;
+  RootStatistics stats = testNode.searchRootParallel(settings, SearchLimits::playouts(400), 1);
+  CHECK(stats.playouts == 400);   // The budget is split between the threads
+  CHECK(stats.ni[0] + stats.ni[1] + stats.ni[2] + stats.ni[3] + stats.ni[4] + stats.ni[5] + stats.ni[6] == 400);
+  CHECK(testNode.chooseMove(stats, settings) == 0);
+
+  settings.useSolver = true;
+  CHECK(testNode.makeMove(settings) == 0);
+}
+
+TEST_CASE("Shared Tree Search Tests") {
+  Node testNode;
+  int moves[] = {0, 1, 0, 1, 0, 1};   // Red to move wins in column 0
+  for (int col : moves){
+    testNode = testNode.getChildNode(col);
+  }
+  SearchSettings settings;
+  settings.threads = 4;
+  settings.useSharedTree = true;
+  SharedTreeCounters counters;
+  RootStatistics stats = testNode.searchSharedTree(settings, SearchLimits::playouts(2000), 1, counters);
+  CHECK(stats.playouts == 2000);
+  CHECK(stats.ni[0] + stats.ni[1] + stats.ni[2] + stats.ni[3] + stats.ni[4] + stats.ni[5] + stats.ni[6] == 2000);
+  CHECK(counters.nodes > 0);
+  CHECK(testNode.chooseMove(stats, settings) == 0);
+
+  // Sharded counters add up to the same totals
+  SharedTreeNode sharded(3);
+  sharded.addResult(0, true, false);
+  sharded.addResult(2, false, true);
+  sharded.addResult(2, false, false);
+  sharded.addVirtualLoss(1, 1);
+  CHECK(sharded.visits() == 3);
+  CHECK(sharded.wins() == 1);
+  CHECK(sharded.draws() == 1);
+  CHECK(sharded.inFlight() == 1);
+  CHECK(sizeof(CounterShard) == 64);
+
+  for (int depth : {0, 1, 3}){
+    settings.shardDepth = depth;
+    SharedTreeCounters shardedCounters;
+    stats = testNode.searchSharedTree(settings, SearchLimits::playouts(1000), 2, shardedCounters);
+    CHECK(stats.playouts == 1000);
+    CHECK(stats.ni[0] + stats.ni[1] + stats.ni[2] + stats.ni[3] + stats.ni[4] + stats.ni[5] + stats.ni[6] == 1000);
+    CHECK(testNode.chooseMove(stats, settings) == 0);
+  }
+
+  WorkStealingPool pool(2);     // The workers run as pool tasks, even on a pool with fewer threads
+  settings.pool = &pool;
+  SharedTreeCounters poolCounters;
+  stats = testNode.searchSharedTree(settings, SearchLimits::playouts(1000), 3, poolCounters);
+  CHECK(stats.playouts == 1000);
+  CHECK(testNode.chooseMove(stats, settings) == 0);
+}
+
+TEST_CASE("Work Stealing Pool Tests") {
+  WorkStealingPool pool(4);
+  TaskGroup group;
+  atomic<int> sum (0);
+  for (int i = 1; i <= 100; i++){
+    pool.submit(group, [&sum, i](){ sum += i; });
+  }
+  pool.wait(group);
+  CHECK(sum == 5050);
+  CHECK(pool.tasksRun >= 100);
+
+  // Tasks may submit more tasks to the same group
+  TaskGroup nested;
+  atomic<int> leaves (0);
+  for (int i = 0; i < 8; i++){
+    pool.submit(nested, [&](){
+      for (int j = 0; j < 8; j++){
+        pool.submit(nested, [&leaves](){ leaves ++; });
+      }
+    });
+  }
+  pool.wait(nested);
+  CHECK(leaves == 64);
+
+  Node testNode;
+  int moves[] = {0, 1, 0, 1, 0, 1};   // Red to move wins in column 0
+  for (int col : moves){
+    testNode = testNode.getChildNode(col);
+  }
+  SearchSettings settings;
+  settings.useTranspositions = false;
+  settings.pool = &pool;
+  RootStatistics stats = testNode.sampleFlatParallel(settings, SearchLimits::playouts(700), 1);
+  CHECK(stats.playouts == 700);
+  CHECK(stats.ni[0] + stats.ni[1] + stats.ni[2] + stats.ni[3] + stats.ni[4] + stats.ni[5] + stats.ni[6] == 700);
+  CHECK(testNode.chooseMove(stats, settings) == 0);
+}
+
+TEST_CASE("Lockless Transposition Table Tests") {
+  LocklessTranspositionTable table(1);
+  TTEntry entry;
+  CHECK_FALSE(table.probe(12345, entry));
+
+  entry.key = 12345;
+  entry.ni = 10;
+  entry.wi = 4;
+  entry.di = 3;
+  entry.isProven = true;
+  entry.provenValue = -1;
+  entry.provenDepth = 7;
+  table.store(entry);
+
+  TTEntry found;
+  REQUIRE(table.probe(12345, found));
+  CHECK(found.ni == 10);
+  CHECK(found.wi == 4);
+  CHECK(found.di == 3);
+  CHECK(found.isProven);
+  CHECK(found.provenValue == -1);
+  CHECK(found.provenDepth == 7);
+  CHECK_FALSE(table.probe(12345 + (table.bucketMask + 1), found));   // Same bucket, different position
+
+  // A torn entry (data changed without the check word) reads as a miss
+  LocklessTranspositionTable::Entry* slot = &table.entries[(12345 & table.bucketMask) * LocklessTranspositionTable::bucketSize];
+  slot->data1 = slot->data1 + 1;
+  CHECK_FALSE(table.probe(12345, found));
+
+  // Several threads searching with one shared table
+  Node testNode;
+  int moves[] = {0, 1, 0, 1, 0, 1};   // Red to move wins in column 0
+  for (int col : moves){
+    testNode = testNode.getChildNode(col);
+  }
+  LocklessTranspositionTable sharedTable(4);
+  SearchSettings settings;
+  settings.threads = 4;
+  settings.useSolver = false;   // Keep searching after column 0 is proven, so the table fills up
+  settings.sharedTable = &sharedTable;
+  CHECK(testNode.makeMove(settings) == 0);
+  CHECK(sharedTable.hitRate() > 0);
+  CHECK(sharedTable.fill() > 0);
+}
+
+TEST_CASE("Pondering Tests") {
+  Node testNode;
+  int moves[] = {3, 3, 2};   // Yellow (the opponent) to move
+  for (int col : moves){
+    testNode = testNode.getChildNode(col);
+  }
+  TranspositionTable table(1);
+  SearchSettings settings;
+  settings.table = &table;
+  Ponderer ponderer(settings);
+
+  ponderer.start(testNode);
+  this_thread::sleep_for(chrono::milliseconds(20));
+  ponderer.opponentMoved(4);    // Search moves on to the position after Yellow's move
+  this_thread::sleep_for(chrono::milliseconds(20));
+  chrono::steady_clock::time_point stopRequested = chrono::steady_clock::now();
+  CHECK(ponderer.stop() > 0);
+  CHECK(chrono::steady_clock::now() - stopRequested < chrono::milliseconds(50));
+
+  TTEntry entry;
+  Node afterMove = testNode.getChildNode(4);
+  REQUIRE(table.probe(afterMove.hashKey, entry));
+  CHECK(entry.ni > 0);    // The new root was searched
+
+  // The move after pondering continues the pondering's search of the table, so its entries aren't the first replaced
+  CHECK(ponderer.pondered(afterMove));
+  CHECK_FALSE(ponderer.pondered(testNode));
+  unsigned generation = table.generation;
+  settings.pondered = true;
+  settings.verbose = false;
+  settings.iterations = 100;
+  afterMove.makeMove(settings);
+  CHECK(table.generation == generation);
+  settings.pondered = false;
+  afterMove.makeMove(settings);
+  CHECK(table.generation == generation + 1);
+}
+
+TEST_CASE("Self-Play Tests") {
+  SearchSettings settings = parseEngineSettings("playouts=200,rave=1,solver=0,table=1", SearchSettings());
+  CHECK(settings.iterations == 200);
+  CHECK(settings.useRave);
+  CHECK_FALSE(settings.useSolver);
+  CHECK(settings.tableSizeMB == 1);
+  CHECK_FALSE(settings.useSharedTree);
+  CHECK(parseEngineSettings("sharedtree=1", settings).useSharedTree);
+
+  SelfPlayOptions options;
+  options.red = parseEngineSettings("playouts=50,table=1", options.red);
+  options.yellow = options.red;
+  options.openingPlies = 4;
+  string firstGame, sameGame;
+  int results = playSelfPlayGame(options, 7, firstGame);
+  CHECK(results >= 1);
+  CHECK(results <= 3);
+  CHECK(firstGame.size() >= 7);
+  playSelfPlayGame(options, 7, sameGame);
+  CHECK(firstGame.substr(0, 4) == sameGame.substr(0, 4));   // Openings only depend on the seed and game number
+}
+
+TEST_CASE("Batch Analysis Tests") {
+  Node position;
+  CHECK(position.playMoves("010101"));
+  CHECK(position.nextPlayer() == 1);
+  Node illegal;
+  CHECK_FALSE(illegal.playMoves("0000000"));   // Column 0 only has six rows
+  CHECK_FALSE(illegal.playMoves("9"));
+
+  BoundedQueue<int> queue(2);
+  queue.push(1);
+  queue.push(2);
+  int item = 0;
+  CHECK(queue.pop(item));
+  CHECK(item == 1);
+  queue.close();
+  CHECK(queue.pop(item));
+  CHECK(item == 2);
+  CHECK_FALSE(queue.pop(item));
+
+  AnalysisOptions options;
+  options.threads = 2;
+  options.queueSize = 1;
+  options.settings.iterations = 300;
+  stringstream input("# comment\n010101\n-\n\n0000000\n33\n\n");   // Blank lines are skipped, "-" is the empty board
+  stringstream output;
+  CHECK(runAnalysis(input, output, options) == 4);
+  vector<string> lines(4);
+  string line;
+  while (getline(output, line)){
+    long long index = atoll(line.c_str());
+    REQUIRE(index >= 0);
+    REQUIRE(index < 4);
+    lines[index] = line;
+  }
+  CHECK(lines[0].substr(0, 11) == "0 010101 0 ");   // Red wins in column 0
+  CHECK(lines[1].substr(0, 4) == "1 - ");           // Empty board
+  CHECK(lines[2] == "2 0000000 invalid");
+  CHECK(lines[3].substr(0, 5) == "3 33 ");
+
+  // Every line only depends on its position and index: the same results on another number of threads, on a given pool
+  WorkStealingPool pool(3);
+  options.threads = 3;
+  options.settings.pool = &pool;
+  stringstream again("010101\n-\n0000000\n33\n");
+  stringstream againOutput;
+  CHECK(runAnalysis(again, againOutput, options) == 4);
+  vector<string> againLines;
+  while (getline(againOutput, line)){
+    againLines.push_back(line);
+  }
+  sort(againLines.begin(), againLines.end());   // Index order (single digit indices)
+  CHECK(againLines == lines);
+}
+
+TEST_CASE("Process Worker Tests") {
+  SearchSettings settings;
+  settings.verbose = false;
+  settings.tableSizeMB = 1;
+  ProcessWorkers workers(3, [settings](const string& request){
+    static TranspositionTable table(settings.tableSizeMB);
+    return Node::answerSearchRequest(request, settings, &table);
+  });
+  REQUIRE(workers.size() == 3);
+  CHECK(workers.alive() == 3);
+
+  Node root;
+  REQUIRE(root.playMoves("010101"));
+  RootStatistics stats = root.searchRootProcesses(workers, settings, SearchLimits::playouts(600), 5);
+  CHECK(stats.playouts <= 600);
+  CHECK(stats.provenValue[0] == 1);    // Red wins in column 0
+  CHECK(root.chooseMove(stats, settings) == 0);
+
+  // A worker that dies is left out, the others still answer
+  kill(workers.pids[1], SIGKILL);
+  Node other;
+  REQUIRE(other.playMoves("33"));
+  stats = other.searchRootProcesses(workers, settings, SearchLimits::playouts(300), 6);
+  CHECK(workers.alive() == 2);
+  CHECK(stats.playouts > 0);
+  CHECK(stats.playouts <= 300);
+
+  // Without workers the search runs in this process
+  kill(workers.pids[0], SIGKILL);
+  kill(workers.pids[2], SIGKILL);
+  stats = other.searchRootProcesses(workers, settings, SearchLimits::playouts(200), 7);
+  CHECK(workers.alive() == 0);
+  CHECK(stats.playouts == 200);
+
+  CHECK(Node::answerSearchRequest("garbage", settings, nullptr) == "error");
+}
+
+TEST_CASE("Deterministic Search Tests") {
+  Node root;
+  REQUIRE(root.playMoves("3342"));
+  SearchSettings settings;
+  settings.verbose = false;
+  settings.tableSizeMB = 1;
+  settings.deterministic = true;
+  settings.seed = 42;
+  settings.threads = 4;
+  SearchLimits limits = SearchLimits::playouts(2000);
+  limits.useDeadline = true;    // Ignored
+  limits.deadline = chrono::steady_clock::now();
+
+  RootStatistics first = root.searchDeterministic(settings, limits);
+  RootStatistics second = root.searchDeterministic(settings, limits);
+  WorkStealingPool pool(3);     // Threads or pool tasks give the same statistics
+  settings.pool = &pool;
+  RootStatistics pooled = root.searchDeterministic(settings, limits);
+  CHECK(first.playouts == 2000);
+  for (const RootStatistics& other : {second, pooled}){
+    CHECK(other.ni == first.ni);
+    CHECK(other.wi == first.wi);
+    CHECK(other.di == first.di);
+    CHECK(other.provenValue == first.provenValue);
+    CHECK(other.playouts == first.playouts);
+  }
+  Node copy = root;
+  CHECK(copy.makeMove(settings, limits) == root.makeMove(settings, limits));
+
+  settings.seed = 43;   // Another seed searches differently
+  RootStatistics reseeded = root.searchDeterministic(settings, limits);
+  CHECK(reseeded.wi != first.wi);
+
+  // The solver isn't cut short by the deadline either, so the move doesn't depend on the machine's speed
+  Node endgame;
+  REQUIRE(endgame.playMoves("321422426301360226"));
+  REQUIRE(endgame.movesLeft() <= settings.solverEmpties);
+  settings.threads = 1;     // Long enough a solve to be interrupted on one thread
+  int solved = endgame.solveMove(settings, SearchLimits());
+  atomic<bool> stop (true);
+  SearchLimits deadline = SearchLimits::until(chrono::steady_clock::now() + chrono::milliseconds(1));
+  deadline.stopFlag = &stop;
+  CHECK(endgame.makeMove(settings, deadline) == solved);
+
+  // It is solved on one thread, so the positions solved and the table hit rate reported don't vary either
+  settings.threads = 4;
+  settings.verbose = true;
+  array<string, 2> reports;
+  for (string& report : reports){
+    ostringstream output;
+    streambuf* console = cout.rdbuf(output.rdbuf());
+    CHECK(endgame.solveMove(settings, SearchLimits()) == solved);
+    cout.rdbuf(console);
+    report = output.str();
+  }
+  CHECK(reports[0].find("Positions solved: ") != string::npos);
+  CHECK(reports[0] == reports[1]);
+}
+
+// Plain negamax over every move (no pruning), to check Solver against
+int bruteForceScore(const BitboardPosition& position){
+  for (int col = 0; col < 7; col++){
+    if (position.canPlay(col) && position.isWinningMove(col)){
+      return (43 - position.moves) / 2;
+    }
+  }
+  if (position.moves == 42){
+    return 0;
+  }
+  int best = -100;
+  for (int col = 0; col < 7; col++){
+    if (position.canPlay(col)){
+      BitboardPosition child = position;
+      child.play(col);
+      best = max(best, -bruteForceScore(child));
+    }
+  }
+  return best;
+}
+
+TEST_CASE("Exact Solver Tests") {
+  Node node;
+  REQUIRE(node.playMoves("010101"));
+  BitboardPosition position = node.bitboard();
+  CHECK(position.moves == 6);
+  CHECK(position.isWinningMove(0));
+  CHECK_FALSE(position.isWinningMove(1));
+  CHECK(Solver::movesToEnd(position, 18) == 1);   // Red's 4th stone
+
+  // The table keeps bounds, and a prime number of entries so that 32 bits of the key are enough
+  SolverTable table(1);
+  CHECK(table.numEntries > (1 << 17));
+  CHECK(table.numEntries % 2 != 0);
+  CHECK(table.get(position.key()) == 0);
+  table.put(position.key(), 37);
+  CHECK(table.get(position.key()) == 37);
+  CHECK(table.get(position.key() + table.numEntries) == 0);   // Same slot, different key
+  CHECK(table.hits == 1);
+  CHECK(table.misses == 2);
+
+  // A stopped solver returns straight away
+  atomic<bool> stop (true);
+  Solver stoppedSolver(&table);
+  stoppedSolver.stopFlag = &stop;
+  Node opening;
+  REQUIRE(opening.playMoves("33"));
+  stoppedSolver.solve(opening.bitboard());
+  CHECK(stoppedSolver.nodeCount <= 1);
+
+  // Random positions with few empty cells, compared with a search without pruning
+  c4Generator generator (3);
+  int checked = 0;
+  while (checked < 20){
+    Node random;
+    int results = -1;
+    while (random.movesLeft() > 10 && results == -1){
+      int col = generator() % 7;
+      if (random.isPossible(col) && !random.bitboard().isWinningMove(col)){
+        Node previous = random;
+        random = previous.getChildNode(col);
+        results = random.getGameState();
+      }
+      else if (!random.bitboard().possibleNonLosingMoves()){
+        results = 0;    // Lost anyway, start again
+      }
+    }
+    if (results != -1 || random.movesLeft() != 10){
+      continue;
+    }
+    BitboardPosition endgame = random.bitboard();
+    Solver solver;
+    int score = solver.solve(endgame);
+    CHECK(score == bruteForceScore(endgame));
+    Solver tableSolver(&table);    // Bounds from earlier positions don't change the result
+    CHECK(tableSolver.solve(endgame) == score);
+    CHECK(tableSolver.solve(endgame, true) == (score > 0) - (score < 0));
+    Solver rotated(nullptr, 1 + checked % 6);   // Another move order
+    CHECK(rotated.solve(endgame) == score);
+    SolverTable sharedTable(1);
+    CHECK(Solver::solveParallel(endgame, false, 3, &sharedTable) == score);
+    array<int, 7> scores = solver.analyze(endgame);
+    CHECK(*max_element(scores.begin(), scores.end()) == score);
+
+
+    // makeMove() plays a move with the best score once the solver takes over
+    SearchSettings settings;
+    settings.verbose = false;
+    settings.solverEmpties = 10;
+    settings.solverWeak = false;
+    Node copy = random;
+    CHECK(scores[copy.makeMove(settings)] == score);
+    settings.solverWeak = true;
+    int weakScore = scores[random.makeMove(settings)];
+    CHECK((weakScore > 0) - (weakScore < 0) == (score > 0) - (score < 0));
+    checked ++;
+  }
+
+  // A solve that can't finish in time is interrupted, and makeMove() searches instead
+  SearchSettings settings;
+  settings.verbose = false;
+  settings.solverEmpties = 42;
+  SearchLimits stopped;
+  stopped.stopFlag = &stop;
+  CHECK(opening.solveMove(settings, stopped) == -1);
+  settings.threads = 2;
+  CHECK(opening.solveMove(settings, stopped) == -1);
+  settings.threads = 1;
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  int move = opening.makeMove(settings, SearchLimits::until(start + chrono::milliseconds(100)));
+  CHECK(chrono::steady_clock::now() - start < chrono::seconds(2));
+  CHECK(opening.isPossible(move));
+}
+
+TEST_CASE("Opening Book Tests") {
+  Node node;
+  REQUIRE(node.playMoves("01"));
+  Node mirror;
+  REQUIRE(mirror.playMoves("65"));
+  bool mirrored;
+  CHECK(node.bitboard().canonicalKey(mirrored) == mirror.bitboard().canonicalKey(mirrored));
+  CHECK(node.bitboard().mirroredKey() == mirror.bitboard().key());
+
+  // Positions up to 2 moves after the root, without mirror images
+  Node empty;
+  CHECK(OpeningBook::enumerate(empty.bitboard(), 2).size() == 1 + 4 + 25);   // Only 33 is its own mirror image after 2 moves
+
+  // A small book from a late position (positions near the empty board take far longer to solve)
+  Node root;
+  REQUIRE(root.playMoves("5034335443443552022263"));
+  vector<uint64_t> entries = OpeningBook::build(root.bitboard(), 3, 1, false);
+  CHECK(is_sorted(entries.begin(), entries.end()));
+  string path = "/tmp/c4_test_book.bin";
+  REQUIRE(OpeningBook::write(path, entries));
+  OpeningBook book;
+  REQUIRE(book.open(path));
+  CHECK(book.size() == entries.size());
+
+  SolverTable table(1);
+  Solver solver(&table);
+  c4Generator generator (11);
+  for (int k = 0; k < 10; k++){
+    Node position = root;
+    for (int ply = generator() % 4; ply > 0; ply--){   // Up to 3 random moves after the root
+      int col = generator() % 7;
+      if (position.isPossible(col) && !position.bitboard().isWinningMove(col)){
+        Node previous = position;
+        position = previous.getChildNode(col);
+      }
+    }
+    int score = 0;
+    int col = book.lookup(position.bitboard(), score);
+    REQUIRE(col != -1);
+    array<int, 7> scores = solver.analyze(position.bitboard());
+    CHECK(scores[col] == score);
+    CHECK(score == *max_element(scores.begin(), scores.end()));
+
+    SearchSettings settings;
+    settings.verbose = false;
+    settings.book = &book;
+    settings.solverEmpties = -1;
+    CHECK(position.makeMove(settings) == col);
+  }
+
+  int score;
+  CHECK(book.lookup(empty.bitboard(), score) == -1);    // Not in the book
+  CHECK_FALSE(book.open("/tmp/c4_no_such_book.bin"));
+  remove(path.c_str());
+
+  // Built on several threads: the same entries
+  CHECK(OpeningBook::build(root.bitboard(), 3, 1, false, 3) == entries);
+
+  // A build resumes from its checkpoint (an entry changed in the checkpoint shows it was not solved again)
+  string checkpointPath = "/tmp/c4_test_book.checkpoint";
+  uint64_t header[2] = {root.bitboard().key(), 3};
+  vector<uint64_t> saved(entries.begin(), entries.begin() + 5);
+  saved[0] ^= 1;    // Another column
+  {
+    ofstream checkpoint(checkpointPath, ios::binary);
+    checkpoint.write("C4CKPT01", 8);
+    checkpoint.write(reinterpret_cast<const char*>(header), sizeof(header));
+    checkpoint.write(reinterpret_cast<const char*>(saved.data()), saved.size() * sizeof(uint64_t));
+    checkpoint.write("abc", 3);   // Cut off while writing an entry
+  }
+  vector<uint64_t> resumed = OpeningBook::build(root.bitboard(), 3, 1, false, 2, checkpointPath);
+  CHECK(resumed.size() == entries.size());
+  CHECK(find(resumed.begin(), resumed.end(), saved[0]) != resumed.end());
+  CHECK(find(resumed.begin(), resumed.end(), entries[0]) == resumed.end());
+  CHECK_FALSE(ifstream(checkpointPath).good());   // Removed once the book is complete
+
+  // A checkpoint of another book is ignored
+  header[1] = 4;
+  {
+    ofstream checkpoint(checkpointPath, ios::binary);
+    checkpoint.write("C4CKPT01", 8);
+    checkpoint.write(reinterpret_cast<const char*>(header), sizeof(header));
+    checkpoint.write(reinterpret_cast<const char*>(saved.data()), saved.size() * sizeof(uint64_t));
+  }
+  CHECK(OpeningBook::build(root.bitboard(), 3, 1, false, 2, checkpointPath) == entries);
+}
+
+TEST_CASE("Perft Tests") {
+  // Move sequences from the empty board (7^n until a column can overflow at 7 moves, OEIS A090224)
+  Node empty;
+  const long long sequences[] = {1, 7, 49, 343, 2401, 16807, 117649};
+  for (int depth = 0; depth <= 4; depth++){
+    CHECK(empty.perft(depth) == sequences[depth]);
+  }
+  for (int depth = 0; depth <= 6; depth++){
+    CHECK(perftBitboard(empty.bitboard(), depth) == sequences[depth]);
+  }
+  WorkStealingPool pool(3);
+  CHECK(perftParallel(empty, 5, false, pool) == sequences[5]);
+  CHECK(perftParallel(empty, 6, true, pool) == sequences[6]);
+  CHECK(perftParallel(empty, 1, true, pool) == 7);
+
+  // Different positions after each ply (OEIS A212693)
+  vector<long long> expected = {1, 7, 49, 238, 1120, 4263, 16422};
+  CHECK(uniquePositions(empty.bitboard(), 6, pool) == expected);
+
+  // Games that are over aren't continued: both kernels agree near the end of a game
+  Node late;
+  REQUIRE(late.playMoves("033422532354253502105044053"));
+  for (int depth = 1; depth <= 5; depth++){
+    CHECK(late.perft(depth) == perftBitboard(late.bitboard(), depth));
+  }
+  Node won;
+  REQUIRE(won.playMoves("0101010"));
+  CHECK(won.perft(1) == 0);
+  CHECK(perftParallel(won, 3, true, pool) == 0);
+}
+
+TEST_CASE("Position Ranking Tests") {
+  // Below the empty board: height vectors times the ways to colour the stones
+  PositionRanking ranking;
+  CHECK(ranking.size(0) == 1);
+  CHECK(ranking.size(1) == 7);
+  CHECK(ranking.size(2) == 28 * 2);
+  CHECK(ranking.size(4) == 210 * 6);
+  CHECK(ranking.size(42) == PositionRanking::binomial(42, 21));
+  CHECK(ranking.size(43) == 0);
+
+  // Every rank is a different position with that many stones, ranked back to the same rank
+  for (uint64_t rank = 0; rank < ranking.size(4); rank++){
+    BitboardPosition position = ranking.unrank(4, rank);
+    CHECK(position.moves == 4);
+    CHECK(__builtin_popcountll(position.mask) == 4);
+    CHECK(__builtin_popcountll(position.current) == 2);
+    CHECK(ranking.rank(position) == rank);
+  }
+
+  // Positions from random games, below the empty board and below a position in the middle of the game
+  Node middle;
+  REQUIRE(middle.playMoves("5034335443443552022263"));
+  PositionRanking below(middle.bitboard());
+  CHECK(below.size(0) == 1);
+  c4Generator generator (9);
+  for (int k = 0; k < 200; k++){
+    BitboardPosition position = (k % 2 == 0) ? BitboardPosition() : middle.bitboard();
+    const PositionRanking& used = (k % 2 == 0) ? ranking : below;
+    int base = position.moves;
+    for (int ply = generator() % 20; ply > 0 && position.moves < 42; ply--){
+      int col = generator() % 7;
+      if (position.canPlay(col)){
+        position.play(col);
+      }
+    }
+    REQUIRE(used.extends(position));
+    uint64_t rank = used.rank(position);
+    CHECK(rank < used.size(position.moves - base));
+    BitboardPosition decoded = used.unrank(position.moves - base, rank);
+    CHECK(decoded.current == position.current);
+    CHECK(decoded.mask == position.mask);
+    CHECK(decoded.moves == position.moves);
+  }
+
+  // Positions without the base's stones (or with different colours) don't extend it
+  Node other;
+  REQUIRE(other.playMoves("3"));
+  CHECK_FALSE(below.extends(other.bitboard()));
+  PositionRanking afterThree(other.bitboard());
+  Node both;
+  REQUIRE(both.playMoves("43"));    // Stone in column 3 played by the other player
+  CHECK_FALSE(afterThree.extends(both.bitboard()));
+  Node same;
+  REQUIRE(same.playMoves("34"));
+  CHECK(afterThree.extends(same.bitboard()));
+}
+
+TEST_CASE("Tablebase Tests") {
+  // Keys give back their positions
+  c4Generator generator (5);
+  for (int k = 0; k < 20; k++){
+    BitboardPosition position;
+    for (int ply = generator() % 30; ply > 0; ply--){
+      int col = generator() % 7;
+      if (position.canPlay(col)){
+        position.play(col);
+      }
+    }
+    BitboardPosition decoded = BitboardPosition::fromKey(position.key());
+    CHECK(decoded.current == position.current);
+    CHECK(decoded.mask == position.mask);
+    CHECK(decoded.moves == position.moves);
+  }
+
+  // Every position with at most 16 empty cells below a root
+  Node root;
+  REQUIRE(root.playMoves("03342253235425350210504405"));
+  string path = "/tmp/c4_test_tablebase.bin";
+  REQUIRE(Tablebase::build(root.bitboard(), 16, path));
+  Tablebase tablebase;
+  REQUIRE(tablebase.open(path));
+  CHECK(tablebase.size() == 7450);
+  CHECK(tablebase.covers(26));
+  CHECK(tablebase.covers(41));
+  CHECK_FALSE(tablebase.covers(25));
+
+  // The same file when the children are marked from runs of 64 ranks (many sorted runs per layer)
+  string runsPath = "/tmp/c4_test_tablebase_runs.bin";
+  REQUIRE(Tablebase::build(root.bitboard(), 16, runsPath, 64));
+  {
+    ifstream one(path, ios::binary);
+    ifstream many(runsPath, ios::binary);
+    CHECK(string(istreambuf_iterator<char>(one), {}) == string(istreambuf_iterator<char>(many), {}));
+  }
+  remove(runsPath.c_str());
+
+  // Only the last 10 empty cells: the layers above are marked in scratch files, which are removed
+  string smallPath = "/tmp/c4_test_tablebase_small.bin";
+  REQUIRE(Tablebase::build(root.bitboard(), 10, smallPath));
+  Tablebase small;
+  REQUIRE(small.open(smallPath));
+  CHECK_FALSE(small.covers(31));
+  CHECK(small.covers(32));
+  CHECK_FALSE(ifstream(smallPath + ".reached30").good());
+  int value = 2;
+  CHECK_FALSE(small.probe(root.bitboard(), value));
+
+  // Values agree with the solver along random games
+  SolverTable table(1);
+  Solver solver(&table);
+  for (int k = 0; k < 20; k++){
+    BitboardPosition position = root.bitboard();
+    while (position.moves < 42 && !position.canWinNext()){
+      value = 2;
+      REQUIRE(tablebase.probe(position, value));
+      int score = solver.solve(position, true);
+      CHECK(value == score);
+      int smallValue = 2;
+      if (position.moves >= 32){
+        REQUIRE(small.probe(position, smallValue));
+        CHECK(smallValue == score);
+      }
+      int col = generator() % 7;
+      if (position.canPlay(col)){
+        position.play(col);
+      }
+    }
+  }
+
+  remove(smallPath.c_str());
+
+  // Moves keep the value, and makeMove() plays them
+  int col = tablebase.bestMove(root.bitboard(), value);
+  REQUIRE(col != -1);
+  CHECK(value == solver.solve(root.bitboard(), true));
+  Node child = root;
+  child = child.getChildNode(col);
+  int childValue = 2;
+  REQUIRE(tablebase.probe(child.bitboard(), childValue));
+  CHECK(childValue == -value);
+  SearchSettings settings;
+  settings.verbose = false;
+  settings.solverEmpties = -1;
+  settings.tablebase = &tablebase;
+  CHECK(root.makeMove(settings) == col);
+
+  // Playouts end with the exact result
+  int expected = (value == 0) ? 3 : (value > 0 ? root.nextPlayer() : 3 - root.nextPlayer());
+  for (int k = 0; k < 5; k++){
+    CHECK(root.playout(generator, nullptr, nullptr, &tablebase) == expected);
+  }
+
+  // Positions that aren't below the root (or have too many empty cells) aren't there
+  Node mirror;
+  REQUIRE(mirror.playMoves("63324413431241316456162261"));    // The root's mirror image
+  CHECK_FALSE(tablebase.probe(mirror.bitboard(), value));
+  Node empty;
+  CHECK(tablebase.bestMove(empty.bitboard(), value) == -1);
+  CHECK_FALSE(tablebase.open("/tmp/c4_no_such_tablebase.bin"));
+  remove(path.c_str());
+}